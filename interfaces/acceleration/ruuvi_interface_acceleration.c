@@ -0,0 +1,25 @@
+/**
+ * Platform-independent helper functions for acceleration data
+ *
+ * License: BSD-3
+ * Author: Otso Jousimaa <otso@ojousima.net>
+ **/
+
+#include "ruuvi_driver_error.h"
+#include "ruuvi_interface_acceleration.h"
+#include <stddef.h>
+
+ruuvi_driver_status_t ruuvi_interface_acceleration_raw_to_g(const ruuvi_interface_acceleration_raw_info_t* const info, const int16_t* const raw, const size_t count, ruuvi_interface_acceleration_data_t* const data)
+{
+  if(NULL == info || NULL == raw || NULL == data) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(0 == info->samplerate_hz || 0 == info->g_per_lsb) { return RUUVI_DRIVER_ERROR_INVALID_PARAM; }
+
+  for(size_t ii = 0; ii < count; ii++)
+  {
+    data[ii].timestamp_ms = info->timestamp_ms - (((count - ii - 1) * 1000) / info->samplerate_hz);
+    data[ii].x_g = (float)(raw[(ii * 3) + 0] >> info->shift) * info->g_per_lsb;
+    data[ii].y_g = (float)(raw[(ii * 3) + 1] >> info->shift) * info->g_per_lsb;
+    data[ii].z_g = (float)(raw[(ii * 3) + 2] >> info->shift) * info->g_per_lsb;
+  }
+  return RUUVI_DRIVER_SUCCESS;
+}
@@ -7,6 +7,8 @@
 #ifndef RUUVI_INTERFACE_ACCELERATION_H
 #define RUUVI_INTERFACE_ACCELERATION_H
 #include "ruuvi_driver_error.h"
+#include <stddef.h>
+#include <stdint.h>
 
 #define RUUVI_INTERFACE_ACCELERATION_INVALID           RUUVI_DRIVER_FLOAT_INVALID
 #define RUUVI_INTERFACE_ACCELERATION_INTERRUPT_DISABLE RUUVI_DRIVER_FLOAT_INVALID
@@ -20,6 +22,29 @@ typedef struct
   float z_g;
 }ruuvi_interface_acceleration_data_t;
 
+// Description of a block of raw samples stored as X, Y, Z int16_t triplets, left-justified as read from the sensor.
+typedef struct
+{
+  uint64_t timestamp_ms;  // Time of the last sample in block
+  uint16_t samplerate_hz; // Samples are 1000 / samplerate_hz ms apart
+  uint8_t  scale_g;       // Full scale, G
+  uint8_t  resolution;    // Bits
+  uint8_t  shift;         // Right shift to drop unused bits of a raw value
+  float    g_per_lsb;     // G per LSB of a shifted raw value
+}ruuvi_interface_acceleration_raw_info_t;
 
+/**
+ * Convert a block of raw samples to acceleration in g.
+ * Timestamps are reconstructed backwards from the last sample of the block.
+ *
+ * parameter info: description of the block
+ * parameter raw: 3 * count raw values
+ * parameter count: number of X, Y, Z triplets to convert
+ * parameter data: array of count acceleration data elements.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if any pointer is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_PARAM if info has zero samplerate or conversion factor
+ */
+ruuvi_driver_status_t ruuvi_interface_acceleration_raw_to_g(const ruuvi_interface_acceleration_raw_info_t* const info, const int16_t* const raw, const size_t count, ruuvi_interface_acceleration_data_t* const data);
 
 #endif
\ No newline at end of file
@@ -11,8 +11,12 @@
 #include "ruuvi_driver_error.h"
 #include "ruuvi_driver_sensor.h"
 #include "ruuvi_interface_acceleration.h"
+#include "ruuvi_interface_gpio.h"
+#include "ruuvi_interface_gpio_interrupt.h"
 #include "ruuvi_interface_lis2dh12.h"
+#include "ruuvi_interface_scheduler.h"
 #include "ruuvi_interface_spi_lis2dh12.h"
+#include "ruuvi_interface_timer.h"
 #include "ruuvi_interface_yield.h"
 
 #include "lis2dh12_reg.h"
@@ -27,35 +31,126 @@
           if(RUUVI_DRIVER_SENSOR_CFG_SLEEP != MACRO_MODE) { return RUUVI_DRIVER_ERROR_INVALID_STATE; } \
           } while(0)
 
-/*!
- * @brief lis2dh12 sensor settings structure.
- */
-static struct {
-  // resolution
-  lis2dh12_op_md_t resolution;
+// Storage of instance initialized with ruuvi_interface_lis2dh12_init
+static ruuvi_interface_lis2dh12_dev_t dev_default = {0};
+
+// Initialized instances, index is the slot sensor function pointers are bound to
+static ruuvi_interface_lis2dh12_dev_t* instances[RUUVI_INTERFACE_LIS2DH12_INSTANCES] = {0};
+
+// Instance the sensor functions operate on
+static ruuvi_interface_lis2dh12_dev_t* p_dev = &dev_default;
+
+// Turn-on time of the sensor when sampling a single sample at 400 Hz, 7/ODR with margin. LIS2DH12 datasheet p.16.
+#define LIS2DH12_SINGLE_SAMPLE_DELAY_MS ((7000 / 400) + 1)
 
-  // scale
-  lis2dh12_fs_t scale;
+RUUVI_PLATFORM_TIMER_ID_DEF(lis2dh12_single_timer);
+static bool single_timer_created = false;
+static ruuvi_interface_lis2dh12_dev_t* p_single_dev = NULL; // Instance sampling asynchronously
+static uint8_t single_sequence = 0; // Identifies asynchronous sample, stale scheduled latches are ignored
 
-  // data rate
-  lis2dh12_odr_t samplerate;
+// Select instance in given slot, return previously selected instance
+static ruuvi_interface_lis2dh12_dev_t* lis2dh12_slot_select(const uint8_t slot)
+{
+  ruuvi_interface_lis2dh12_dev_t* const previous = p_dev;
+  if(RUUVI_INTERFACE_LIS2DH12_INSTANCES > slot && NULL != instances[slot]) { p_dev = instances[slot]; }
+  return previous;
+}
 
-  // self-test
-  lis2dh12_st_t selftest;
+// Return slot of instance with given chip select handle, RUUVI_INTERFACE_LIS2DH12_INSTANCES if not found
+static uint8_t lis2dh12_slot_find(const uint8_t handle)
+{
+  for(uint8_t slot = 0; slot < RUUVI_INTERFACE_LIS2DH12_INSTANCES; slot++)
+  {
+    if(NULL != instances[slot] && handle == instances[slot]->handle) { return slot; }
+  }
+  return RUUVI_INTERFACE_LIS2DH12_INSTANCES;
+}
 
-  // operating mode, handle
-  uint8_t mode, handle;
+/*
+ * Sensor function pointers do not carry context, so each slot gets its own set of functions
+ * which select the instance of the slot for the call and restore the selection of application afterwards.
+ */
+#define LIS2DH12_BIND_CALL(slot, call) \
+  { \
+    ruuvi_interface_lis2dh12_dev_t* const previous = lis2dh12_slot_select(slot); \
+    ruuvi_driver_status_t err_code = call; \
+    p_dev = previous; \
+    return err_code; \
+  }
 
-  uint64_t tsample; // Time of last sample in single mode.
+#define LIS2DH12_BIND_SETUP(slot, function) \
+  static ruuvi_driver_status_t lis2dh12_##function##_##slot(uint8_t* value) \
+  LIS2DH12_BIND_CALL(slot, ruuvi_interface_lis2dh12_##function(value))
+
+#define LIS2DH12_BIND_SLOT(slot) \
+  LIS2DH12_BIND_SETUP(slot, samplerate_set) \
+  LIS2DH12_BIND_SETUP(slot, samplerate_get) \
+  LIS2DH12_BIND_SETUP(slot, resolution_set) \
+  LIS2DH12_BIND_SETUP(slot, resolution_get) \
+  LIS2DH12_BIND_SETUP(slot, scale_set) \
+  LIS2DH12_BIND_SETUP(slot, scale_get) \
+  LIS2DH12_BIND_SETUP(slot, mode_set) \
+  LIS2DH12_BIND_SETUP(slot, mode_get) \
+  static ruuvi_driver_status_t lis2dh12_dsp_set_##slot(uint8_t* dsp, uint8_t* parameter) \
+  LIS2DH12_BIND_CALL(slot, ruuvi_interface_lis2dh12_dsp_set(dsp, parameter)) \
+  static ruuvi_driver_status_t lis2dh12_dsp_get_##slot(uint8_t* dsp, uint8_t* parameter) \
+  LIS2DH12_BIND_CALL(slot, ruuvi_interface_lis2dh12_dsp_get(dsp, parameter)) \
+  static ruuvi_driver_status_t lis2dh12_data_get_##slot(void* data) \
+  LIS2DH12_BIND_CALL(slot, ruuvi_interface_lis2dh12_data_get(data))
+
+#define LIS2DH12_BINDINGS(slot) { \
+  .samplerate_set = lis2dh12_samplerate_set_##slot, \
+  .samplerate_get = lis2dh12_samplerate_get_##slot, \
+  .resolution_set = lis2dh12_resolution_set_##slot, \
+  .resolution_get = lis2dh12_resolution_get_##slot, \
+  .scale_set      = lis2dh12_scale_set_##slot,      \
+  .scale_get      = lis2dh12_scale_get_##slot,      \
+  .dsp_set        = lis2dh12_dsp_set_##slot,        \
+  .dsp_get        = lis2dh12_dsp_get_##slot,        \
+  .mode_set       = lis2dh12_mode_set_##slot,       \
+  .mode_get       = lis2dh12_mode_get_##slot,       \
+  .data_get       = lis2dh12_data_get_##slot        \
+  }
 
-  // device control structure
-  lis2dh12_ctx_t ctx;
-}dev = {0};
+#if RUUVI_INTERFACE_LIS2DH12_INSTANCES > 4
+  #error "Bindings are defined for up to 4 LIS2DH12 instances"
+#endif
+
+LIS2DH12_BIND_SLOT(0)
+#if RUUVI_INTERFACE_LIS2DH12_INSTANCES > 1
+LIS2DH12_BIND_SLOT(1)
+#endif
+#if RUUVI_INTERFACE_LIS2DH12_INSTANCES > 2
+LIS2DH12_BIND_SLOT(2)
+#endif
+#if RUUVI_INTERFACE_LIS2DH12_INSTANCES > 3
+LIS2DH12_BIND_SLOT(3)
+#endif
+
+static const struct {
+  ruuvi_driver_sensor_setup_fp samplerate_set, samplerate_get;
+  ruuvi_driver_sensor_setup_fp resolution_set, resolution_get;
+  ruuvi_driver_sensor_setup_fp scale_set, scale_get;
+  ruuvi_driver_sensor_dsp_fp   dsp_set, dsp_get;
+  ruuvi_driver_sensor_setup_fp mode_set, mode_get;
+  ruuvi_driver_sensor_data_fp  data_get;
+} bindings[RUUVI_INTERFACE_LIS2DH12_INSTANCES] = {
+  LIS2DH12_BINDINGS(0),
+#if RUUVI_INTERFACE_LIS2DH12_INSTANCES > 1
+  LIS2DH12_BINDINGS(1),
+#endif
+#if RUUVI_INTERFACE_LIS2DH12_INSTANCES > 2
+  LIS2DH12_BINDINGS(2),
+#endif
+#if RUUVI_INTERFACE_LIS2DH12_INSTANCES > 3
+  LIS2DH12_BINDINGS(3),
+#endif
+};
 
 // Check that self-test values differ enough
 static ruuvi_driver_status_t lis2dh12_verify_selftest_difference(axis3bit16_t* new, axis3bit16_t* old)
 {
-  if(LIS2DH12_2g != dev.scale || LIS2DH12_NM_10bit != dev.resolution) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  if(LIS2DH12_2g != p_dev->scale || LIS2DH12_NM_10bit != p_dev->resolution) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
 
   // Calculate positive diffs of each axes and compare to expected change
   for(size_t ii = 0; ii < 3; ii++)
@@ -70,71 +165,124 @@ static ruuvi_driver_status_t lis2dh12_verify_selftest_difference(axis3bit16_t* n
   return RUUVI_DRIVER_SUCCESS;
 }
 
-ruuvi_driver_status_t ruuvi_interface_lis2dh12_init(ruuvi_driver_sensor_t* acceleration_sensor, ruuvi_driver_bus_t bus, uint8_t handle)
+/**
+ * Update conversion from left-justified raw values to g.
+ * Call after scale or resolution has changed.
+ */
+static ruuvi_driver_status_t lis2dh12_conversion_update(void)
 {
-  if(NULL == acceleration_sensor) { return RUUVI_DRIVER_ERROR_NULL; }
-  if(NULL != dev.ctx.write_reg) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
-  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
-  // Initialize mems driver interface
-  lis2dh12_ctx_t* dev_ctx = &(dev.ctx);
-  switch(bus)
+  // mg / LSb at 2 G scale, datasheet. Data is left-justified, shift drops unused bits.
+  float mg_per_lsb = 0;
+  p_dev->g_per_lsb = 0;
+  switch(p_dev->resolution)
   {
-    case RUUVI_DRIVER_BUS_SPI:
-      dev_ctx->write_reg = ruuvi_interface_spi_lis2dh12_write;
-      dev_ctx->read_reg = ruuvi_interface_spi_lis2dh12_read;
+    case LIS2DH12_LP_8bit:
+      p_dev->shift = 8;
+      mg_per_lsb = 16.0f;
       break;
 
-    case RUUVI_DRIVER_BUS_I2C:
-      return RUUVI_DRIVER_ERROR_NOT_IMPLEMENTED;
+    case LIS2DH12_NM_10bit:
+      p_dev->shift = 6;
+      mg_per_lsb = 4.0f;
+      break;
+
+    case LIS2DH12_HR_12bit:
+      p_dev->shift = 4;
+      mg_per_lsb = 1.0f;
+      break;
 
     default:
-      return RUUVI_DRIVER_ERROR_NOT_SUPPORTED;
+      return RUUVI_DRIVER_ERROR_INTERNAL;
   }
 
-  dev.handle = handle;
-  dev_ctx->handle = &dev.handle;
-  dev.mode = RUUVI_DRIVER_SENSOR_CFG_SLEEP;
+  switch(p_dev->scale)
+  {
+    case LIS2DH12_2g:
+      break;
 
-  // Check device ID
-  uint8_t whoamI = 0;
-  lis2dh12_device_id_get(dev_ctx, &whoamI);
-  if ( whoamI != LIS2DH12_ID ) { return RUUVI_DRIVER_ERROR_NOT_FOUND; }
+    case LIS2DH12_4g:
+      mg_per_lsb *= 2;
+      break;
 
-  // Disable FIFO, activity
-  lis2dh12_fm_t mode = LIS2DH12_BYPASS_MODE;
-  lis2dh12_fifo_mode_set(&(dev.ctx), mode);
-  ruuvi_interface_lis2dh12_fifo_use(false);
-  ruuvi_interface_lis2dh12_fifo_interrupt_use(false);
+    case LIS2DH12_8g:
+      mg_per_lsb *= 4;
+      break;
 
-  float ths = 0;
-  ruuvi_interface_lis2dh12_activity_interrupt_use(false, &ths);
+    case LIS2DH12_16g:
+      mg_per_lsb *= 12;
+      break;
 
-  // Turn X-, Y-, Z-measurement on
-  uint8_t enable_axes = 0x07;
-  lis2dh12_write_reg(dev_ctx, LIS2DH12_CTRL_REG1, &enable_axes, 1);
+    default:
+      return RUUVI_DRIVER_ERROR_INTERNAL;
+  }
+  p_dev->g_per_lsb = mg_per_lsb / 1000;
+  return RUUVI_DRIVER_SUCCESS;
+}
 
-  // Disable Block Data Update, allow values to update even if old is not read
-  lis2dh12_block_data_update_set(dev_ctx, PROPERTY_DISABLE);
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_init(ruuvi_driver_sensor_t* acceleration_sensor, ruuvi_driver_bus_t bus, uint8_t handle)
+{
+  return ruuvi_interface_lis2dh12_instance_init(acceleration_sensor, bus, handle, &dev_default);
+}
 
-    // Set Output Data Rate for self-test
-  dev.samplerate = LIS2DH12_ODR_400Hz;
-  lis2dh12_data_rate_set(dev_ctx, dev.samplerate);
+// Self-test results kept over warm boots, given by application
+static ruuvi_interface_lis2dh12_selftest_cache_t* p_selftest_cache = NULL;
+static size_t selftest_cache_entries = 0;
 
-  // Set full scale to 2G for self-test
-  dev.scale = LIS2DH12_2g;
-  lis2dh12_full_scale_set(dev_ctx, dev.scale);
+static uint32_t lis2dh12_selftest_cache_check(const ruuvi_interface_lis2dh12_selftest_cache_t* const entry)
+{
+  return ~(entry->key ^ ((uint32_t)entry->handle << 8) ^ entry->verdict);
+}
 
-  // (Don't) Enable temperature sensor
-  //lis2dh12_temperature_meas_set(&dev_ctx, LIS2DH12_TEMP_ENABLE);
+// Return true if sensor with given handle has a valid passed self-test in cache
+static bool lis2dh12_selftest_cached(const uint8_t handle)
+{
+  for(size_t ii = 0; ii < selftest_cache_entries; ii++)
+  {
+    const ruuvi_interface_lis2dh12_selftest_cache_t* const entry = &(p_selftest_cache[ii]);
+    if(RUUVI_INTERFACE_LIS2DH12_SELFTEST_CACHE_KEY == entry->key
+       && lis2dh12_selftest_cache_check(entry) == entry->check
+       && handle == entry->handle)
+    {
+      return RUUVI_INTERFACE_LIS2DH12_SELFTEST_PASSED == entry->verdict;
+    }
+  }
+  return false;
+}
 
-  // Set device in 10 bit mode
-  dev.resolution = LIS2DH12_NM_10bit;
-  lis2dh12_operating_mode_set(dev_ctx, dev.resolution);
+// Store passed self-test of sensor with given handle to first invalid or matching entry of cache
+static void lis2dh12_selftest_cache_store(const uint8_t handle)
+{
+  ruuvi_interface_lis2dh12_selftest_cache_t* free_entry = NULL;
+  for(size_t ii = 0; ii < selftest_cache_entries; ii++)
+  {
+    ruuvi_interface_lis2dh12_selftest_cache_t* const entry = &(p_selftest_cache[ii]);
+    bool valid = RUUVI_INTERFACE_LIS2DH12_SELFTEST_CACHE_KEY == entry->key
+                 && lis2dh12_selftest_cache_check(entry) == entry->check;
+    if(valid && handle == entry->handle) { free_entry = entry; break; }
+    if(!valid && NULL == free_entry)     { free_entry = entry; }
+  }
+  if(NULL == free_entry) { return; }
+  free_entry->key = RUUVI_INTERFACE_LIS2DH12_SELFTEST_CACHE_KEY;
+  free_entry->handle = handle;
+  free_entry->verdict = RUUVI_INTERFACE_LIS2DH12_SELFTEST_PASSED;
+  free_entry->check = lis2dh12_selftest_cache_check(free_entry);
+}
+
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_selftest_cache_set(ruuvi_interface_lis2dh12_selftest_cache_t* const cache, const size_t entries)
+{
+  if(NULL == cache && 0 != entries) { return RUUVI_DRIVER_ERROR_NULL; }
+  p_selftest_cache = cache;
+  selftest_cache_entries = (NULL == cache) ? 0 : entries;
+  return RUUVI_DRIVER_SUCCESS;
+}
 
-  // Run self-test
+// Run positive and negative self-test. Sensor must be in 2 G 10 bit mode at 400 Hz.
+static ruuvi_driver_status_t lis2dh12_selftest(lis2dh12_ctx_t* const dev_ctx)
+{
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
   // turn self-test off.
-  dev.selftest = LIS2DH12_ST_DISABLE;
-  err_code |= lis2dh12_self_test_set(dev_ctx, dev.selftest);
+  p_dev->selftest = LIS2DH12_ST_DISABLE;
+  err_code |= lis2dh12_self_test_set(dev_ctx, p_dev->selftest);
   // wait for valid sample to be available, 3 samples at 400 Hz = 2.5 ms / sample => 7.5 ms. Wait 9 ms.
   ruuvi_platform_delay_ms(9);
 
@@ -146,8 +294,8 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_init(ruuvi_driver_sensor_t* accel
   lis2dh12_acceleration_raw_get(dev_ctx, data_raw_acceleration_old.u8bit);
 
   // self-test to positive direction
-  dev.selftest = LIS2DH12_ST_POSITIVE;
-  lis2dh12_self_test_set(dev_ctx, dev.selftest);
+  p_dev->selftest = LIS2DH12_ST_POSITIVE;
+  lis2dh12_self_test_set(dev_ctx, p_dev->selftest);
 
   // wait 2 samples in low power or normal mode for valid data.
   ruuvi_platform_delay_ms(9);
@@ -158,16 +306,16 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_init(ruuvi_driver_sensor_t* accel
   RUUVI_DRIVER_ERROR_CHECK(err_code, RUUVI_DRIVER_SUCCESS);
 
   // turn self-test off, keep error code in case we "lose" sensor after self-test
-  dev.selftest = LIS2DH12_ST_DISABLE;
-  err_code |= lis2dh12_self_test_set(dev_ctx, dev.selftest);
+  p_dev->selftest = LIS2DH12_ST_DISABLE;
+  err_code |= lis2dh12_self_test_set(dev_ctx, p_dev->selftest);
 
   // wait 2 samples and read value
   ruuvi_platform_delay_ms(9);
   lis2dh12_acceleration_raw_get(dev_ctx, data_raw_acceleration_old.u8bit);
 
   // self-test to negative direction
-  dev.selftest = LIS2DH12_ST_NEGATIVE;
-  lis2dh12_self_test_set(dev_ctx, dev.selftest);
+  p_dev->selftest = LIS2DH12_ST_NEGATIVE;
+  lis2dh12_self_test_set(dev_ctx, p_dev->selftest);
 
   // wait 2 samples
   ruuvi_platform_delay_ms(9);
@@ -177,38 +325,161 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_init(ruuvi_driver_sensor_t* accel
   err_code |= lis2dh12_verify_selftest_difference(&data_raw_acceleration_new, &data_raw_acceleration_old);
   RUUVI_DRIVER_ERROR_CHECK(err_code, RUUVI_DRIVER_SUCCESS);
 
+  return err_code;
+}
+
+// Initialize selected instance
+static ruuvi_driver_status_t lis2dh12_init(ruuvi_driver_bus_t bus, uint8_t handle)
+{
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  // Initialize mems driver interface
+  lis2dh12_ctx_t* dev_ctx = &(p_dev->ctx);
+  switch(bus)
+  {
+    case RUUVI_DRIVER_BUS_SPI:
+      dev_ctx->write_reg = ruuvi_interface_spi_lis2dh12_write;
+      dev_ctx->read_reg = ruuvi_interface_spi_lis2dh12_read;
+      break;
+
+    case RUUVI_DRIVER_BUS_I2C:
+      return RUUVI_DRIVER_ERROR_NOT_IMPLEMENTED;
+
+    default:
+      return RUUVI_DRIVER_ERROR_NOT_SUPPORTED;
+  }
+
+  p_dev->handle = handle;
+  dev_ctx->handle = &p_dev->handle;
+  p_dev->mode = RUUVI_DRIVER_SENSOR_CFG_SLEEP;
+  p_dev->watermark = RUUVI_INTERFACE_LIS2DH12_DEFAULT_WATERMARK;
+
+  // Check device ID
+  uint8_t whoamI = 0;
+  lis2dh12_device_id_get(dev_ctx, &whoamI);
+  if ( whoamI != LIS2DH12_ID ) { return RUUVI_DRIVER_ERROR_NOT_FOUND; }
+
+  // Disable FIFO, activity
+  lis2dh12_fm_t mode = LIS2DH12_BYPASS_MODE;
+  lis2dh12_fifo_mode_set(&(p_dev->ctx), mode);
+  ruuvi_interface_lis2dh12_fifo_use(false);
+  ruuvi_interface_lis2dh12_fifo_interrupt_use(false);
+
+  float ths = 0;
+  ruuvi_interface_lis2dh12_activity_interrupt_use(false, &ths);
+
+  // Turn X-, Y-, Z-measurement on
+  uint8_t enable_axes = 0x07;
+  lis2dh12_write_reg(dev_ctx, LIS2DH12_CTRL_REG1, &enable_axes, 1);
+
+  // Disable Block Data Update, allow values to update even if old is not read
+  lis2dh12_block_data_update_set(dev_ctx, PROPERTY_DISABLE);
+
+  // Set Output Data Rate for self-test
+  p_dev->samplerate = LIS2DH12_ODR_400Hz;
+  lis2dh12_data_rate_set(dev_ctx, p_dev->samplerate);
+
+  // Set full scale to 2G for self-test
+  p_dev->scale = LIS2DH12_2g;
+  lis2dh12_full_scale_set(dev_ctx, p_dev->scale);
+
+  // (Don't) Enable temperature sensor
+  //lis2dh12_temperature_meas_set(&dev_ctx, LIS2DH12_TEMP_ENABLE);
+
+  // Set device in 10 bit mode
+  p_dev->resolution = LIS2DH12_NM_10bit;
+  lis2dh12_operating_mode_set(dev_ctx, p_dev->resolution);
+
+  // Run self-test unless sensor has already passed it
+  if(!lis2dh12_selftest_cached(handle))
+  {
+    err_code |= lis2dh12_selftest(dev_ctx);
+    if(RUUVI_DRIVER_SUCCESS == err_code) { lis2dh12_selftest_cache_store(handle); }
+  }
+
   // turn self-test off, keep error code in case we "lose" sensor after self-test
-  dev.selftest = LIS2DH12_ST_DISABLE;
-  err_code |= lis2dh12_self_test_set(dev_ctx, dev.selftest);
+  p_dev->selftest = LIS2DH12_ST_DISABLE;
+  err_code |= lis2dh12_self_test_set(dev_ctx, p_dev->selftest);
+
+  // Self-test leaves sensor in 2 G 10 bit mode
+  err_code |= lis2dh12_conversion_update();
 
   // Turn accelerometer off
-  dev.samplerate = LIS2DH12_POWER_DOWN;
-  err_code |= lis2dh12_data_rate_set(dev_ctx, dev.samplerate);
+  p_dev->samplerate = LIS2DH12_POWER_DOWN;
+  err_code |= lis2dh12_data_rate_set(dev_ctx, p_dev->samplerate);
   RUUVI_DRIVER_ERROR_CHECK(err_code, RUUVI_DRIVER_SUCCESS);
 
+  p_dev->tsample = RUUVI_DRIVER_UINT64_INVALID;
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_instance_init(ruuvi_driver_sensor_t* acceleration_sensor, ruuvi_driver_bus_t bus, uint8_t handle, ruuvi_interface_lis2dh12_dev_t* const instance)
+{
+  if(NULL == acceleration_sensor || NULL == instance) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(NULL != instance->ctx.write_reg) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  if(RUUVI_INTERFACE_LIS2DH12_INSTANCES != lis2dh12_slot_find(handle)) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+
+  // Reserve a slot for instance
+  uint8_t slot = 0;
+  while(RUUVI_INTERFACE_LIS2DH12_INSTANCES > slot && NULL != instances[slot]) { slot++; }
+  if(RUUVI_INTERFACE_LIS2DH12_INSTANCES == slot) { return RUUVI_DRIVER_ERROR_RESOURCES; }
+  memset(instance, 0, sizeof(ruuvi_interface_lis2dh12_dev_t));
+  instances[slot] = instance;
+  ruuvi_interface_lis2dh12_dev_t* const previous = lis2dh12_slot_select(slot);
+
+  ruuvi_driver_status_t err_code = lis2dh12_init(bus, handle);
   if(RUUVI_DRIVER_SUCCESS == err_code)
   {
     acceleration_sensor->init              = ruuvi_interface_lis2dh12_init;
     acceleration_sensor->uninit            = ruuvi_interface_lis2dh12_uninit;
-    acceleration_sensor->samplerate_set    = ruuvi_interface_lis2dh12_samplerate_set;
-    acceleration_sensor->samplerate_get    = ruuvi_interface_lis2dh12_samplerate_get;
-    acceleration_sensor->resolution_set    = ruuvi_interface_lis2dh12_resolution_set;
-    acceleration_sensor->resolution_get    = ruuvi_interface_lis2dh12_resolution_get;
-    acceleration_sensor->scale_set         = ruuvi_interface_lis2dh12_scale_set;
-    acceleration_sensor->scale_get         = ruuvi_interface_lis2dh12_scale_get;
-    acceleration_sensor->dsp_set           = ruuvi_interface_lis2dh12_dsp_set;
-    acceleration_sensor->dsp_get           = ruuvi_interface_lis2dh12_dsp_get;
-    acceleration_sensor->mode_set          = ruuvi_interface_lis2dh12_mode_set;
-    acceleration_sensor->mode_get          = ruuvi_interface_lis2dh12_mode_get;
-    acceleration_sensor->data_get          = ruuvi_interface_lis2dh12_data_get;
-    acceleration_sensor->configuration_set = ruuvi_driver_sensor_configuration_set;
+    acceleration_sensor->samplerate_set    = bindings[slot].samplerate_set;
+    acceleration_sensor->samplerate_get    = bindings[slot].samplerate_get;
+    acceleration_sensor->resolution_set    = bindings[slot].resolution_set;
+    acceleration_sensor->resolution_get    = bindings[slot].resolution_get;
+    acceleration_sensor->scale_set         = bindings[slot].scale_set;
+    acceleration_sensor->scale_get         = bindings[slot].scale_get;
+    acceleration_sensor->dsp_set           = bindings[slot].dsp_set;
+    acceleration_sensor->dsp_get           = bindings[slot].dsp_get;
+    acceleration_sensor->mode_set          = bindings[slot].mode_set;
+    acceleration_sensor->mode_get          = bindings[slot].mode_get;
+    acceleration_sensor->data_get          = bindings[slot].data_get;
+    acceleration_sensor->configuration_set = ruuvi_interface_lis2dh12_configuration_set;
     acceleration_sensor->configuration_get = ruuvi_driver_sensor_configuration_get;
-    dev.tsample = RUUVI_DRIVER_UINT64_INVALID;
- }
+  }
+  // Release slot of instance which could not be initialized
+  else
+  {
+    memset(instance, 0, sizeof(ruuvi_interface_lis2dh12_dev_t));
+    instances[slot] = NULL;
+  }
+  // Keep selection of application, select the new instance only if nothing was selected yet.
+  if(previous != instance && NULL != previous->ctx.write_reg) { p_dev = previous; }
+  else if(NULL == instances[slot]) { p_dev = &dev_default; }
 
   return err_code;
 }
 
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_instance_select(const uint8_t handle)
+{
+  uint8_t slot = lis2dh12_slot_find(handle);
+  if(RUUVI_INTERFACE_LIS2DH12_INSTANCES == slot) { return RUUVI_DRIVER_ERROR_NOT_FOUND; }
+  lis2dh12_slot_select(slot);
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_instance_selected(uint8_t* const handle)
+{
+  if(NULL == handle) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(NULL == p_dev->ctx.write_reg) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  *handle = p_dev->handle;
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+lis2dh12_ctx_t* ruuvi_interface_lis2dh12_ctx_get(void)
+{
+  if(NULL == p_dev->ctx.write_reg) { return NULL; }
+  return &(p_dev->ctx);
+}
+
 /*
  * Lis2dh12 does not have a proper softreset (boot does not reset all registers)
  * Therefore just stop sampling
@@ -216,121 +487,199 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_init(ruuvi_driver_sensor_t* accel
 ruuvi_driver_status_t ruuvi_interface_lis2dh12_uninit(ruuvi_driver_sensor_t* sensor, ruuvi_driver_bus_t bus, uint8_t handle)
 {
   if(NULL == sensor) { return RUUVI_DRIVER_ERROR_NULL; }
-  dev.samplerate = LIS2DH12_POWER_DOWN;
+  uint8_t slot = lis2dh12_slot_find(handle);
+  if(RUUVI_INTERFACE_LIS2DH12_INSTANCES == slot) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  ruuvi_interface_lis2dh12_dev_t* const previous = lis2dh12_slot_select(slot);
+  // Abort ongoing asynchronous sample
+  if(p_single_dev == p_dev)
+  {
+    ruuvi_platform_timer_stop(lis2dh12_single_timer);
+    p_single_dev = NULL;
+  }
+  // Release interrupt pin of FIFO drain
+  if(NULL != p_dev->p_ring) { ruuvi_platform_gpio_interrupt_disable(p_dev->drain_pin); }
+  p_dev->samplerate = LIS2DH12_POWER_DOWN;
   memset(sensor, 0, sizeof(ruuvi_driver_sensor_t));
   //LIS2DH12 function returns SPI write result which is ruuvi_driver_status_t
-  ruuvi_driver_status_t err_code = lis2dh12_data_rate_set(&(dev.ctx), dev.samplerate);
-  memset(&dev, 0, sizeof(dev));
+  ruuvi_driver_status_t err_code = lis2dh12_data_rate_set(&(p_dev->ctx), p_dev->samplerate);
+  memset(p_dev, 0, sizeof(ruuvi_interface_lis2dh12_dev_t));
+  instances[slot] = NULL;
+  // Keep selection of application unless the uninitialized instance was selected.
+  p_dev = (previous == p_dev) ? &dev_default : previous;
   return err_code;
 }
 
 /**
  * Set up samplerate. Powers down sensor on SAMPLERATE_STOP, writes value to
  * lis2dh12 only if mode is continous as writing samplerate to sensor starts sampling.
- * MAX is 200 Hz as it can be represented by the configuration format
+ * MAX is 200 Hz as it can be represented by the configuration format, use
+ * ruuvi_interface_lis2dh12_samplerate_hz_set for higher rates.
  * Samplerate is rounded up, i.e. "Please give me at least samplerate F.", 5 is rounded to 10 Hz etc.
  */
-ruuvi_driver_status_t ruuvi_interface_lis2dh12_samplerate_set(uint8_t* samplerate)
+// Convert samplerate to output data rate. Rate is left as is on NO_CHANGE and EXTENDED.
+static ruuvi_driver_status_t lis2dh12_samplerate_to_odr(uint8_t* const samplerate, lis2dh12_odr_t* const odr)
 {
-  if(NULL == samplerate)                                { return RUUVI_DRIVER_ERROR_NULL; }
-  VERIFY_SENSOR_SLEEPS();
   ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
-
   if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == *samplerate)   {}
-  else if(RUUVI_DRIVER_SENSOR_CFG_MIN == *samplerate)    { dev.samplerate = LIS2DH12_ODR_1Hz;   }
-  else if(RUUVI_DRIVER_SENSOR_CFG_MAX == *samplerate)    { dev.samplerate = LIS2DH12_ODR_200Hz; }
-  else if(RUUVI_DRIVER_SENSOR_CFG_DEFAULT == *samplerate){ dev.samplerate = LIS2DH12_ODR_1Hz;   }
-  else if(1   == *samplerate)                            { dev.samplerate = LIS2DH12_ODR_1Hz;   }
-  else if(10  >= *samplerate)                            { dev.samplerate = LIS2DH12_ODR_10Hz;  }
-  else if(25  >= *samplerate)                            { dev.samplerate = LIS2DH12_ODR_25Hz;  }
-  else if(50  >= *samplerate)                            { dev.samplerate = LIS2DH12_ODR_50Hz;  }
-  else if(100 >= *samplerate)                            { dev.samplerate = LIS2DH12_ODR_100Hz; }
-  else if(200 >= *samplerate)                            { dev.samplerate = LIS2DH12_ODR_200Hz; }
+  else if(RUUVI_DRIVER_SENSOR_CFG_EXTENDED == *samplerate) {}
+  else if(RUUVI_DRIVER_SENSOR_CFG_MIN == *samplerate)    { *odr = LIS2DH12_ODR_1Hz;   }
+  else if(RUUVI_DRIVER_SENSOR_CFG_MAX == *samplerate)    { *odr = LIS2DH12_ODR_200Hz; }
+  else if(RUUVI_DRIVER_SENSOR_CFG_DEFAULT == *samplerate){ *odr = LIS2DH12_ODR_1Hz;   }
+  else if(1   == *samplerate)                            { *odr = LIS2DH12_ODR_1Hz;   }
+  else if(10  >= *samplerate)                            { *odr = LIS2DH12_ODR_10Hz;  }
+  else if(25  >= *samplerate)                            { *odr = LIS2DH12_ODR_25Hz;  }
+  else if(50  >= *samplerate)                            { *odr = LIS2DH12_ODR_50Hz;  }
+  else if(100 >= *samplerate)                            { *odr = LIS2DH12_ODR_100Hz; }
+  else if(200 >= *samplerate)                            { *odr = LIS2DH12_ODR_200Hz; }
   else { *samplerate = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED; err_code |= RUUVI_DRIVER_ERROR_NOT_SUPPORTED; }
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_samplerate_set(uint8_t* samplerate)
+{
+  if(NULL == samplerate)                                { return RUUVI_DRIVER_ERROR_NULL; }
+  VERIFY_SENSOR_SLEEPS();
+  ruuvi_driver_status_t err_code = lis2dh12_samplerate_to_odr(samplerate, &(p_dev->samplerate));
 
   if(RUUVI_DRIVER_SUCCESS == err_code)
   {
-    err_code |= lis2dh12_data_rate_set(&(dev.ctx), dev.samplerate);
+    err_code |= lis2dh12_data_rate_set(&(p_dev->ctx), p_dev->samplerate);
     err_code |= ruuvi_interface_lis2dh12_samplerate_get(samplerate);
   }
   return err_code;
 }
 
 /*
- *. Read sample rate to pointer
+ * Convert output data rate to Hz, 0 if sensor is powered down or rate is unknown.
  */
-ruuvi_driver_status_t ruuvi_interface_lis2dh12_samplerate_get(uint8_t* samplerate)
+static uint16_t lis2dh12_odr_to_hz(const lis2dh12_odr_t odr)
 {
-  if(NULL == samplerate) { return RUUVI_DRIVER_ERROR_NULL; }
-  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
-
-  err_code |= lis2dh12_data_rate_get(&(dev.ctx), &dev.samplerate);
-  switch(dev.samplerate)
+  switch(odr)
   {
     case LIS2DH12_ODR_1Hz:
-      *samplerate = 1;
-      break;
+      return 1;
 
     case LIS2DH12_ODR_10Hz:
-      *samplerate = 10;
-      break;
+      return 10;
 
     case LIS2DH12_ODR_25Hz:
-      *samplerate = 25;
-      break;
+      return 25;
 
     case LIS2DH12_ODR_50Hz:
-      *samplerate = 50;
-      break;
+      return 50;
 
     case LIS2DH12_ODR_100Hz:
-      *samplerate = 100;
-      break;
+      return 100;
 
     case LIS2DH12_ODR_200Hz:
-      *samplerate = 200;
-      break;
+      return 200;
+
+    case LIS2DH12_ODR_400Hz:
+      return 400;
+
+    case LIS2DH12_ODR_1kHz620_LP:
+      return 1620;
+
+    // Same setting is 5376 Hz in low power mode and 1344 Hz in normal and high resolution modes.
+    case LIS2DH12_ODR_5kHz376_LP_1kHz344_NM_HP:
+      return (LIS2DH12_LP_8bit == p_dev->resolution) ? 5376 : 1344;
 
     default:
-      *samplerate = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED;
-      err_code |=  RUUVI_DRIVER_ERROR_INTERNAL;
+      return 0;
   }
+}
+
+// Convert output data rate to samplerate of configuration
+static ruuvi_driver_status_t lis2dh12_odr_to_samplerate(const lis2dh12_odr_t odr, uint8_t* const samplerate)
+{
+  uint16_t rate = lis2dh12_odr_to_hz(odr);
+  if(0 == rate)
+  {
+    *samplerate = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED;
+    return RUUVI_DRIVER_ERROR_INTERNAL;
+  }
+  // Rates above 200 Hz cannot be represented in configuration.
+  else if(200 < rate) { *samplerate = RUUVI_DRIVER_SENSOR_CFG_EXTENDED; }
+  else { *samplerate = (uint8_t)rate; }
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+/*
+ *. Read sample rate to pointer
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_samplerate_get(uint8_t* samplerate)
+{
+  if(NULL == samplerate) { return RUUVI_DRIVER_ERROR_NULL; }
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+
+  err_code |= lis2dh12_data_rate_get(&(p_dev->ctx), &p_dev->samplerate);
+  err_code |= lis2dh12_odr_to_samplerate(p_dev->samplerate, samplerate);
   return err_code;
 }
 
 /**
- * Setup resolution. Resolution is rounded up, i.e. "please give at least this many bits"
+ * Set up samplerate in Hz, including rates above 200 Hz.
+ * 1620 and 5376 Hz are available only at 8 bit resolution and 1344 Hz only at 10 and 12 bit resolutions.
+ * Samplerate is rounded up to next rate available at current resolution.
  */
-ruuvi_driver_status_t ruuvi_interface_lis2dh12_resolution_set(uint8_t* resolution)
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_samplerate_hz_set(uint16_t* samplerate)
 {
-  if(NULL == resolution)                               { return RUUVI_DRIVER_ERROR_NULL; }
+  if(NULL == samplerate) { return RUUVI_DRIVER_ERROR_NULL; }
   VERIFY_SENSOR_SLEEPS();
   ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
-
-  if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == *resolution)    { }
-  else if(RUUVI_DRIVER_SENSOR_CFG_MIN == *resolution)     { dev.resolution = LIS2DH12_LP_8bit;  }
-  else if(RUUVI_DRIVER_SENSOR_CFG_MAX == *resolution)     { dev.resolution = LIS2DH12_HR_12bit; }
-  else if(RUUVI_DRIVER_SENSOR_CFG_DEFAULT == *resolution) { dev.samplerate = LIS2DH12_NM_10bit; }
-  else if(8 >= *resolution )                              { dev.resolution = LIS2DH12_LP_8bit;  }
-  else if(10 >= *resolution )                             { dev.resolution = LIS2DH12_NM_10bit; }
-  else if(12 >= *resolution )                             { dev.resolution = LIS2DH12_HR_12bit; }
-  else { *resolution = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED; err_code |= RUUVI_DRIVER_ERROR_NOT_SUPPORTED; }
+  bool low_power = (LIS2DH12_LP_8bit == p_dev->resolution);
+
+  if(0 == *samplerate)          { err_code |= RUUVI_DRIVER_ERROR_NOT_SUPPORTED; }
+  else if(1   == *samplerate)   { p_dev->samplerate = LIS2DH12_ODR_1Hz;   }
+  else if(10  >= *samplerate)   { p_dev->samplerate = LIS2DH12_ODR_10Hz;  }
+  else if(25  >= *samplerate)   { p_dev->samplerate = LIS2DH12_ODR_25Hz;  }
+  else if(50  >= *samplerate)   { p_dev->samplerate = LIS2DH12_ODR_50Hz;  }
+  else if(100 >= *samplerate)   { p_dev->samplerate = LIS2DH12_ODR_100Hz; }
+  else if(200 >= *samplerate)   { p_dev->samplerate = LIS2DH12_ODR_200Hz; }
+  else if(400 >= *samplerate)   { p_dev->samplerate = LIS2DH12_ODR_400Hz; }
+  else if(low_power  && 1620 >= *samplerate) { p_dev->samplerate = LIS2DH12_ODR_1kHz620_LP; }
+  else if(low_power  && 5376 >= *samplerate) { p_dev->samplerate = LIS2DH12_ODR_5kHz376_LP_1kHz344_NM_HP; }
+  else if(!low_power && 1344 >= *samplerate) { p_dev->samplerate = LIS2DH12_ODR_5kHz376_LP_1kHz344_NM_HP; }
+  else { err_code |= RUUVI_DRIVER_ERROR_NOT_SUPPORTED; }
 
   if(RUUVI_DRIVER_SUCCESS == err_code)
   {
-    err_code |= lis2dh12_operating_mode_set(&(dev.ctx), dev.resolution);
-    err_code |= ruuvi_interface_lis2dh12_resolution_get(resolution);
+    err_code |= lis2dh12_data_rate_set(&(p_dev->ctx), p_dev->samplerate);
+    err_code |= ruuvi_interface_lis2dh12_samplerate_hz_get(samplerate);
   }
   return err_code;
 }
 
-ruuvi_driver_status_t ruuvi_interface_lis2dh12_resolution_get(uint8_t* resolution)
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_samplerate_hz_get(uint16_t* samplerate)
 {
-  if(NULL == resolution) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(NULL == samplerate) { return RUUVI_DRIVER_ERROR_NULL; }
   ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
 
-  err_code |= lis2dh12_operating_mode_get(&(dev.ctx), &dev.resolution);
-  switch(dev.resolution)
+  err_code |= lis2dh12_data_rate_get(&(p_dev->ctx), &p_dev->samplerate);
+  *samplerate = lis2dh12_odr_to_hz(p_dev->samplerate);
+  if(0 == *samplerate) { err_code |= RUUVI_DRIVER_ERROR_INTERNAL; }
+  return err_code;
+}
+
+// Convert resolution to operating mode. Mode is left as is on NO_CHANGE.
+static ruuvi_driver_status_t lis2dh12_resolution_to_mode(uint8_t* const resolution, lis2dh12_op_md_t* const mode)
+{
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == *resolution)    { }
+  else if(RUUVI_DRIVER_SENSOR_CFG_MIN == *resolution)     { *mode = LIS2DH12_LP_8bit;  }
+  else if(RUUVI_DRIVER_SENSOR_CFG_MAX == *resolution)     { *mode = LIS2DH12_HR_12bit; }
+  else if(RUUVI_DRIVER_SENSOR_CFG_DEFAULT == *resolution) { *mode = LIS2DH12_NM_10bit; }
+  else if(8 >= *resolution )                              { *mode = LIS2DH12_LP_8bit;  }
+  else if(10 >= *resolution )                             { *mode = LIS2DH12_NM_10bit; }
+  else if(12 >= *resolution )                             { *mode = LIS2DH12_HR_12bit; }
+  else { *resolution = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED; err_code |= RUUVI_DRIVER_ERROR_NOT_SUPPORTED; }
+  return err_code;
+}
+
+// Convert operating mode to resolution in bits
+static ruuvi_driver_status_t lis2dh12_mode_to_resolution(const lis2dh12_op_md_t mode, uint8_t* const resolution)
+{
+  switch(mode)
   {
     case LIS2DH12_LP_8bit:
     *resolution = 8;
@@ -346,51 +695,70 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_resolution_get(uint8_t* resolutio
 
     default:
     *resolution = RUUVI_DRIVER_SENSOR_ERR_INVALID;
-    err_code |= RUUVI_DRIVER_ERROR_INTERNAL;
-    break;
+    return RUUVI_DRIVER_ERROR_INTERNAL;
   }
-  return err_code;
+  return RUUVI_DRIVER_SUCCESS;
 }
 
 /**
- * Setup lis2dh12 scale. Scale is rounded up, i.e. "at least this much"
+ * Setup resolution. Resolution is rounded up, i.e. "please give at least this many bits"
  */
-ruuvi_driver_status_t ruuvi_interface_lis2dh12_scale_set(uint8_t* scale)
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_resolution_set(uint8_t* resolution)
 {
-  if(NULL == scale)                               { return RUUVI_DRIVER_ERROR_NULL; }
+  if(NULL == resolution)                               { return RUUVI_DRIVER_ERROR_NULL; }
   VERIFY_SENSOR_SLEEPS();
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+
+  lis2dh12_op_md_t mode = p_dev->resolution;
+  err_code |= lis2dh12_resolution_to_mode(resolution, &mode);
 
+  // 1620 Hz is available only in low power mode
+  if(LIS2DH12_ODR_1kHz620_LP == p_dev->samplerate && LIS2DH12_LP_8bit != mode) { err_code |= RUUVI_DRIVER_ERROR_INVALID_STATE; }
+
+  if(RUUVI_DRIVER_SUCCESS == err_code)
+  {
+    p_dev->resolution = mode;
+    err_code |= lis2dh12_operating_mode_set(&(p_dev->ctx), p_dev->resolution);
+    err_code |= ruuvi_interface_lis2dh12_resolution_get(resolution);
+  }
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_resolution_get(uint8_t* resolution)
+{
+  if(NULL == resolution) { return RUUVI_DRIVER_ERROR_NULL; }
   ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
 
+  err_code |= lis2dh12_operating_mode_get(&(p_dev->ctx), &p_dev->resolution);
+  err_code |= lis2dh12_conversion_update();
+  err_code |= lis2dh12_mode_to_resolution(p_dev->resolution, resolution);
+  return err_code;
+}
+
+// Convert scale to full scale setting. Setting is left as is on NO_CHANGE.
+static ruuvi_driver_status_t lis2dh12_scale_to_fs(uint8_t* const scale, lis2dh12_fs_t* const fs)
+{
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
   if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == *scale)    { }
-  else if(RUUVI_DRIVER_SENSOR_CFG_MIN == *scale)     { dev.scale = LIS2DH12_2g; }
-  else if(RUUVI_DRIVER_SENSOR_CFG_MAX == *scale)     { dev.scale = LIS2DH12_16g; }
-  else if(RUUVI_DRIVER_SENSOR_CFG_DEFAULT == *scale) { dev.scale = LIS2DH12_2g;  }
-  else if(2  >= *scale)                              { dev.scale = LIS2DH12_2g;  }
-  else if(4  >= *scale)                              { dev.scale = LIS2DH12_4g;  }
-  else if(8  >= *scale)                              { dev.scale = LIS2DH12_8g;  }
-  else if(16 >= *scale)                              { dev.scale = LIS2DH12_16g; }
+  else if(RUUVI_DRIVER_SENSOR_CFG_MIN == *scale)     { *fs = LIS2DH12_2g; }
+  else if(RUUVI_DRIVER_SENSOR_CFG_MAX == *scale)     { *fs = LIS2DH12_16g; }
+  else if(RUUVI_DRIVER_SENSOR_CFG_DEFAULT == *scale) { *fs = LIS2DH12_2g;  }
+  else if(2  >= *scale)                              { *fs = LIS2DH12_2g;  }
+  else if(4  >= *scale)                              { *fs = LIS2DH12_4g;  }
+  else if(8  >= *scale)                              { *fs = LIS2DH12_8g;  }
+  else if(16 >= *scale)                              { *fs = LIS2DH12_16g; }
   else
   {
     *scale = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED;
     err_code |= RUUVI_DRIVER_ERROR_NOT_SUPPORTED;
   }
-  if(RUUVI_DRIVER_SUCCESS == err_code)
-  {
-    err_code |= lis2dh12_full_scale_set(&(dev.ctx), dev.scale);
-    err_code |= ruuvi_interface_lis2dh12_scale_get(scale);
-  }
-
   return err_code;
 }
 
-ruuvi_driver_status_t ruuvi_interface_lis2dh12_scale_get(uint8_t* scale)
+// Convert full scale setting to scale in g
+static ruuvi_driver_status_t lis2dh12_fs_to_scale(const lis2dh12_fs_t fs, uint8_t* const scale)
 {
-  if(NULL == scale) { return RUUVI_DRIVER_ERROR_NULL; }
-  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
-
-  err_code |= lis2dh12_full_scale_get(&(dev.ctx), &dev.scale);
-  switch(dev.scale)
+  switch(fs)
   {
     case LIS2DH12_2g:
       *scale = 2;
@@ -410,77 +778,118 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_scale_get(uint8_t* scale)
 
     default:
        *scale = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED;
-      err_code |= RUUVI_DRIVER_ERROR_INTERNAL;
+      return RUUVI_DRIVER_ERROR_INTERNAL;
   }
-  return err_code;
+  return RUUVI_DRIVER_SUCCESS;
 }
 
-ruuvi_driver_status_t ruuvi_interface_lis2dh12_dsp_set(uint8_t* dsp, uint8_t* parameter)
+/**
+ * Setup lis2dh12 scale. Scale is rounded up, i.e. "at least this much"
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_scale_set(uint8_t* scale)
 {
-  if(NULL == dsp || NULL == parameter) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(NULL == scale)                               { return RUUVI_DRIVER_ERROR_NULL; }
   VERIFY_SENSOR_SLEEPS();
+
+  ruuvi_driver_status_t err_code = lis2dh12_scale_to_fs(scale, &(p_dev->scale));
+  if(RUUVI_DRIVER_SUCCESS == err_code)
+  {
+    err_code |= lis2dh12_full_scale_set(&(p_dev->ctx), p_dev->scale);
+    err_code |= ruuvi_interface_lis2dh12_scale_get(scale);
+  }
+
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_scale_get(uint8_t* scale)
+{
+  if(NULL == scale) { return RUUVI_DRIVER_ERROR_NULL; }
   ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
-  // Read original values in case one is NO_CHANGE and other should be adjusted.
-  uint8_t orig_dsp, orig_param;
-  err_code |= ruuvi_interface_lis2dh12_dsp_get(&orig_dsp, &orig_param);
-  if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == *dsp)       { *dsp       = orig_dsp; }
-  if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == *parameter) { *parameter = orig_param; }
 
+  err_code |= lis2dh12_full_scale_get(&(p_dev->ctx), &p_dev->scale);
+  err_code |= lis2dh12_conversion_update();
+  err_code |= lis2dh12_fs_to_scale(p_dev->scale, scale);
+  return err_code;
+}
+
+// Convert DSP function and parameter to high-pass filter setup. NO_CHANGE must be resolved by caller.
+static ruuvi_driver_status_t lis2dh12_dsp_to_high_pass(uint8_t* const dsp, uint8_t* const parameter, bool* const enable, lis2dh12_hpcf_t* const hpcf)
+{
   if(RUUVI_DRIVER_SENSOR_DSP_HIGH_PASS == *dsp)
   {
-    lis2dh12_hpcf_t hpcf;
     // Set default here to avoid duplicate value error in switch-case
     if(RUUVI_DRIVER_SENSOR_CFG_DEFAULT == *parameter) { *parameter = 0; }
     switch (*parameter)
     {
       case RUUVI_DRIVER_SENSOR_CFG_MIN:
       case 0:
-        hpcf = LIS2DH12_LIGHT;
+        *hpcf = LIS2DH12_LIGHT;
         *parameter = 0;
         break;
 
       case 1:
-        hpcf = LIS2DH12_MEDIUM;
+        *hpcf = LIS2DH12_MEDIUM;
         break;
 
       case 2:
-        hpcf = LIS2DH12_STRONG;
+        *hpcf = LIS2DH12_STRONG;
         break;
 
       case RUUVI_DRIVER_SENSOR_CFG_MAX:
       case 3:
-        hpcf = LIS2DH12_AGGRESSIVE;
+        *hpcf = LIS2DH12_AGGRESSIVE;
         *parameter = 3;
         break;
 
       default :
-        *parameter = RUUVI_DRIVER_ERROR_NOT_SUPPORTED;
+        *parameter = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED;
         return RUUVI_DRIVER_ERROR_NOT_SUPPORTED;
     }
-    err_code |= lis2dh12_high_pass_bandwidth_set(&(dev.ctx), hpcf);
-    err_code |= lis2dh12_high_pass_mode_set(&(dev.ctx), LIS2DH12_NORMAL);
-    err_code |= lis2dh12_high_pass_on_outputs_set(&(dev.ctx), PROPERTY_ENABLE);
-    return err_code;
+    *enable = true;
+    return RUUVI_DRIVER_SUCCESS;
   }
   if(RUUVI_DRIVER_SENSOR_DSP_LAST == *dsp ||
      RUUVI_DRIVER_SENSOR_CFG_DEFAULT == *dsp)
   {
-    err_code |= lis2dh12_high_pass_on_outputs_set(&(dev.ctx), PROPERTY_DISABLE);
+    *enable = false;
     *dsp = RUUVI_DRIVER_SENSOR_DSP_LAST;
-    return err_code;
+    return RUUVI_DRIVER_SUCCESS;
   }
   return RUUVI_DRIVER_ERROR_NOT_SUPPORTED;
 }
 
-ruuvi_driver_status_t ruuvi_interface_lis2dh12_dsp_get(uint8_t* dsp, uint8_t* parameter)
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_dsp_set(uint8_t* dsp, uint8_t* parameter)
 {
+  if(NULL == dsp || NULL == parameter) { return RUUVI_DRIVER_ERROR_NULL; }
+  VERIFY_SENSOR_SLEEPS();
   ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
-  uint8_t mode, hpcf;
-  err_code |= lis2dh12_high_pass_bandwidth_get(&(dev.ctx), &hpcf);
-  err_code |= lis2dh12_high_pass_on_outputs_get(&(dev.ctx), &mode);
-  if(mode) { *dsp = RUUVI_DRIVER_SENSOR_DSP_HIGH_PASS; }
-  else { *dsp = RUUVI_DRIVER_SENSOR_DSP_LAST; }
+  // Read original values in case one is NO_CHANGE and other should be adjusted.
+  uint8_t orig_dsp, orig_param;
+  err_code |= ruuvi_interface_lis2dh12_dsp_get(&orig_dsp, &orig_param);
+  if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == *dsp)       { *dsp       = orig_dsp; }
+  if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == *parameter) { *parameter = orig_param; }
+
+  bool enable = false;
+  lis2dh12_hpcf_t hpcf = LIS2DH12_LIGHT;
+  ruuvi_driver_status_t dsp_status = lis2dh12_dsp_to_high_pass(dsp, parameter, &enable, &hpcf);
+  if(RUUVI_DRIVER_SUCCESS != dsp_status) { return dsp_status; }
 
+  if(enable)
+  {
+    err_code |= lis2dh12_high_pass_bandwidth_set(&(p_dev->ctx), hpcf);
+    err_code |= lis2dh12_high_pass_mode_set(&(p_dev->ctx), LIS2DH12_NORMAL);
+    err_code |= lis2dh12_high_pass_on_outputs_set(&(p_dev->ctx), PROPERTY_ENABLE);
+  }
+  else
+  {
+    err_code |= lis2dh12_high_pass_on_outputs_set(&(p_dev->ctx), PROPERTY_DISABLE);
+  }
+  return err_code;
+}
+
+// Convert high-pass filter cutoff to DSP parameter
+static ruuvi_driver_status_t lis2dh12_hpcf_to_parameter(const uint8_t hpcf, uint8_t* const parameter)
+{
   switch(hpcf)
   {
     case LIS2DH12_LIGHT:
@@ -503,7 +912,30 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_dsp_get(uint8_t* dsp, uint8_t* pa
       *parameter  = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED;
       return RUUVI_DRIVER_ERROR_INTERNAL;
   }
+  return RUUVI_DRIVER_SUCCESS;
+}
 
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_dsp_get(uint8_t* dsp, uint8_t* parameter)
+{
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  uint8_t mode, hpcf;
+  err_code |= lis2dh12_high_pass_bandwidth_get(&(p_dev->ctx), &hpcf);
+  err_code |= lis2dh12_high_pass_on_outputs_get(&(p_dev->ctx), &mode);
+  if(mode) { *dsp = RUUVI_DRIVER_SENSOR_DSP_HIGH_PASS; }
+  else { *dsp = RUUVI_DRIVER_SENSOR_DSP_LAST; }
+  err_code |= lis2dh12_hpcf_to_parameter(hpcf, parameter);
+  return err_code;
+}
+
+// Latch the sample started by single mode and power the sensor down.
+static ruuvi_driver_status_t lis2dh12_single_latch(void)
+{
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  err_code |= lis2dh12_acceleration_raw_get(&(p_dev->ctx), p_dev->latched.u8bit);
+  p_dev->tsample = ruuvi_driver_sensor_timestamp_get();
+  // Do not store power down to instance to continue at previous data rate on continuous mode.
+  err_code |= lis2dh12_data_rate_set(&(p_dev->ctx), LIS2DH12_POWER_DOWN);
+  p_dev->mode = RUUVI_DRIVER_SENSOR_CFG_SLEEP;
   return err_code;
 }
 
@@ -513,7 +945,7 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_mode_set(uint8_t* mode)
   ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
   if(RUUVI_DRIVER_SENSOR_CFG_SINGLE == *mode)
   {
-    // Do nothing if sensor is in continuous mode
+    // Do nothing if sensor is in continuous mode or sampling asynchronously
     uint8_t current_mode;
     ruuvi_interface_lis2dh12_mode_get(&current_mode);
     if(RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS == current_mode)
@@ -521,15 +953,13 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_mode_set(uint8_t* mode)
       *mode = RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS;
       return RUUVI_DRIVER_ERROR_INVALID_STATE;
     }
+    if(RUUVI_DRIVER_SENSOR_CFG_SINGLE == current_mode) { return RUUVI_DRIVER_ERROR_BUSY; }
     // Start sensor at 400 Hz (highest common samplerate)
     // and wait for 7/ODR ms for turn-on (?) NOTE: 7 s / 400 just to be on safe side.
     // Refer to LIS2DH12 datasheet p.16.
-    dev.samplerate = LIS2DH12_ODR_400Hz;
-    err_code |= lis2dh12_data_rate_set(&(dev.ctx), dev.samplerate);
-    ruuvi_platform_delay_ms((7000 / 400) + 1);
-    dev.tsample = ruuvi_driver_sensor_timestamp_get();
-    dev.samplerate = LIS2DH12_POWER_DOWN;
-    err_code |= lis2dh12_data_rate_set(&(dev.ctx), dev.samplerate);
+    err_code |= lis2dh12_data_rate_set(&(p_dev->ctx), LIS2DH12_ODR_400Hz);
+    ruuvi_platform_delay_ms(LIS2DH12_SINGLE_SAMPLE_DELAY_MS);
+    err_code |= lis2dh12_single_latch();
     *mode = RUUVI_DRIVER_SENSOR_CFG_SLEEP;
 
     return err_code;
@@ -537,17 +967,25 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_mode_set(uint8_t* mode)
 
 
 
-  // Do not store power down mode to dev structure, so we can continue at previous data rate
+  // Do not store power down mode to instance, so we can continue at previous data rate
   // when mode is set to continous.
   if(RUUVI_DRIVER_SENSOR_CFG_SLEEP == *mode)
   {
-    dev.mode = *mode;
-    err_code |= lis2dh12_data_rate_set(&(dev.ctx), LIS2DH12_POWER_DOWN);
+    // Abort ongoing asynchronous sample
+    if(RUUVI_DRIVER_SENSOR_CFG_SINGLE == p_dev->mode)
+    {
+      err_code |= ruuvi_platform_timer_stop(lis2dh12_single_timer);
+      p_dev->single_cb = NULL;
+      p_single_dev = NULL;
+    }
+    p_dev->mode = *mode;
+    err_code |= lis2dh12_data_rate_set(&(p_dev->ctx), LIS2DH12_POWER_DOWN);
   }
   else if(RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS == *mode)
   {
-    dev.mode = *mode;
-    err_code |= lis2dh12_data_rate_set(&(dev.ctx), dev.samplerate);
+    if(RUUVI_DRIVER_SENSOR_CFG_SINGLE == p_dev->mode) { return RUUVI_DRIVER_ERROR_BUSY; }
+    p_dev->mode = *mode;
+    err_code |= lis2dh12_data_rate_set(&(p_dev->ctx), p_dev->samplerate);
   }
   else { err_code |= RUUVI_DRIVER_ERROR_INVALID_PARAM; }
   return err_code;
@@ -557,12 +995,17 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_mode_get(uint8_t* mode)
 {
   if(NULL == mode) { return RUUVI_DRIVER_ERROR_NULL; }
 
-  switch(dev.mode)
+  switch(p_dev->mode)
   {
     case RUUVI_DRIVER_SENSOR_CFG_SLEEP:
       *mode = RUUVI_DRIVER_SENSOR_CFG_SLEEP;
       break;
 
+    // Asynchronous single sample is ongoing
+    case RUUVI_DRIVER_SENSOR_CFG_SINGLE:
+      *mode = RUUVI_DRIVER_SENSOR_CFG_SINGLE;
+      break;
+
     case RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS:
       *mode = RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS;
       break;
@@ -574,118 +1017,143 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_mode_get(uint8_t* mode)
   return RUUVI_DRIVER_SUCCESS;
 }
 
+// Number of control registers written by configuration, CTRL_REG1 ... CTRL_REG4.
+#define LIS2DH12_CONFIGURATION_REGS 4
+
 /**
- * Convert raw value to acceleration in mg
- *
- * parameter raw: Input. Raw values from LIS2DH12
- * parameter acceleration: Output. Acceleration values in mg
- *
+ * Apply configuration to selected instance. Configuration is validated first, then control registers
+ * are read in one transaction and the changed range is written in one transaction.
+ * CTRL_REG3 is between the written registers and is written back as it was read.
  */
-static ruuvi_driver_status_t rawToMg(const axis3bit16_t* raw_acceleration, float* acceleration)
+static ruuvi_driver_status_t lis2dh12_configuration_apply(ruuvi_driver_sensor_configuration_t* const config)
 {
+  if(RUUVI_DRIVER_SENSOR_CFG_SINGLE == p_dev->mode) { return RUUVI_DRIVER_ERROR_BUSY; }
   ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
-
-  for(size_t ii = 0; ii < 3; ii++)
+  uint8_t regs[LIS2DH12_CONFIGURATION_REGS];
+  err_code |= lis2dh12_read_reg(&(p_dev->ctx), LIS2DH12_CTRL_REG1, regs, sizeof(regs));
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+  lis2dh12_ctrl_reg1_t ctrl_reg1;
+  lis2dh12_ctrl_reg2_t ctrl_reg2;
+  lis2dh12_ctrl_reg4_t ctrl_reg4;
+  memcpy(&ctrl_reg1, &regs[0], 1);
+  memcpy(&ctrl_reg2, &regs[1], 1);
+  memcpy(&ctrl_reg4, &regs[3], 1);
+
+  // Validate whole configuration in RAM before touching the sensor
+  lis2dh12_odr_t odr = p_dev->samplerate;
+  lis2dh12_op_md_t op_md = p_dev->resolution;
+  lis2dh12_fs_t fs = p_dev->scale;
+  bool high_pass = ctrl_reg2.fds;
+  lis2dh12_hpcf_t hpcf = (lis2dh12_hpcf_t)ctrl_reg2.hpcf;
+  err_code |= lis2dh12_samplerate_to_odr(&(config->samplerate), &odr);
+  err_code |= lis2dh12_resolution_to_mode(&(config->resolution), &op_md);
+  err_code |= lis2dh12_scale_to_fs(&(config->scale), &fs);
+  if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE != config->dsp_function)
   {
-    switch(dev.scale)
+    if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == config->dsp_parameter)
     {
-      case LIS2DH12_2g:
-        switch(dev.resolution)
-        {
-          case LIS2DH12_LP_8bit:
-            acceleration[ii] = LIS2DH12_FROM_FS_2g_LP_TO_mg(raw_acceleration->i16bit[ii]);
-            break;
-
-          case LIS2DH12_NM_10bit:
-            acceleration[ii] = LIS2DH12_FROM_FS_2g_NM_TO_mg(raw_acceleration->i16bit[ii]);
-            break;
-
-          case LIS2DH12_HR_12bit:
-            acceleration[ii] = LIS2DH12_FROM_FS_2g_HR_TO_mg(raw_acceleration->i16bit[ii]);
-            break;
-
-          default:
-            acceleration[ii] = RUUVI_INTERFACE_ACCELERATION_INVALID;
-            err_code |= RUUVI_DRIVER_ERROR_INTERNAL;
-            break;
-        }
-        break;
-
-      case LIS2DH12_4g:
-        switch(dev.resolution)
-        {
-          case LIS2DH12_LP_8bit:
-            acceleration[ii] = LIS2DH12_FROM_FS_4g_LP_TO_mg(raw_acceleration->i16bit[ii]);
-            break;
-
-          case LIS2DH12_NM_10bit:
-            acceleration[ii] = LIS2DH12_FROM_FS_4g_NM_TO_mg(raw_acceleration->i16bit[ii]);
-            break;
-
-          case LIS2DH12_HR_12bit:
-            acceleration[ii] = LIS2DH12_FROM_FS_4g_HR_TO_mg(raw_acceleration->i16bit[ii]);
-            break;
-
-          default:
-            acceleration[ii] = RUUVI_INTERFACE_ACCELERATION_INVALID;
-            err_code |= RUUVI_DRIVER_ERROR_INTERNAL;
-            break;
-        }
-        break;
+      err_code |= lis2dh12_hpcf_to_parameter(hpcf, &(config->dsp_parameter));
+    }
+    err_code |= lis2dh12_dsp_to_high_pass(&(config->dsp_function), &(config->dsp_parameter), &high_pass, &hpcf);
+  }
+  // 1620 Hz is available only in low power mode
+  if(LIS2DH12_ODR_1kHz620_LP == odr && LIS2DH12_LP_8bit != op_md) { err_code |= RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  if(RUUVI_DRIVER_SENSOR_CFG_SLEEP         != config->mode
+     && RUUVI_DRIVER_SENSOR_CFG_SINGLE     != config->mode
+     && RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS != config->mode)
+  {
+    err_code |= RUUVI_DRIVER_ERROR_INVALID_PARAM;
+  }
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+
+  // Compute register image. Single sample is started from sleep after configuration.
+  ctrl_reg1.odr  = (RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS == config->mode) ? odr : LIS2DH12_POWER_DOWN;
+  ctrl_reg1.lpen = (LIS2DH12_LP_8bit == op_md);
+  ctrl_reg4.hr   = (LIS2DH12_HR_12bit == op_md);
+  ctrl_reg4.fs   = fs;
+  ctrl_reg2.fds  = high_pass;
+  if(high_pass)
+  {
+    ctrl_reg2.hpcf = hpcf;
+    ctrl_reg2.hpm  = LIS2DH12_NORMAL;
+  }
+  uint8_t image[LIS2DH12_CONFIGURATION_REGS];
+  memcpy(image, regs, sizeof(image));
+  memcpy(&image[0], &ctrl_reg1, 1);
+  memcpy(&image[1], &ctrl_reg2, 1);
+  memcpy(&image[3], &ctrl_reg4, 1);
+
+  // Write changed range only
+  uint8_t first = 0;
+  uint8_t last = LIS2DH12_CONFIGURATION_REGS;
+  while(first < LIS2DH12_CONFIGURATION_REGS && image[first] == regs[first]) { first++; }
+  while(last > first && image[last - 1] == regs[last - 1]) { last--; }
+  if(first < last)
+  {
+    err_code |= lis2dh12_write_reg(&(p_dev->ctx), LIS2DH12_CTRL_REG1 + first, &image[first], last - first);
+    if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+  }
 
-        case LIS2DH12_8g:
-        switch(dev.resolution)
-        {
-          case LIS2DH12_LP_8bit:
-            acceleration[ii] = LIS2DH12_FROM_FS_8g_LP_TO_mg(raw_acceleration->i16bit[ii]);
-            break;
-
-          case LIS2DH12_NM_10bit:
-            acceleration[ii] = LIS2DH12_FROM_FS_8g_NM_TO_mg(raw_acceleration->i16bit[ii]);
-            break;
-
-          case LIS2DH12_HR_12bit:
-            acceleration[ii] = LIS2DH12_FROM_FS_8g_HR_TO_mg(raw_acceleration->i16bit[ii]);
-            break;
-
-          default:
-            acceleration[ii] = RUUVI_INTERFACE_ACCELERATION_INVALID;
-            err_code |= RUUVI_DRIVER_ERROR_INTERNAL;
-          break;
-        }
-      break;
+  p_dev->samplerate = odr;
+  p_dev->resolution = op_md;
+  p_dev->scale = fs;
+  p_dev->mode = (RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS == config->mode) ? RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS : RUUVI_DRIVER_SENSOR_CFG_SLEEP;
+  err_code |= lis2dh12_conversion_update();
+  if(RUUVI_DRIVER_SENSOR_CFG_SINGLE == config->mode)
+  {
+    err_code |= ruuvi_interface_lis2dh12_mode_set(&(config->mode));
+  }
 
-      case LIS2DH12_16g:
-        switch(dev.resolution)
-        {
-          case LIS2DH12_LP_8bit:
-            acceleration[ii] = LIS2DH12_FROM_FS_16g_LP_TO_mg(raw_acceleration->i16bit[ii]);
-            break;
-
-          case LIS2DH12_NM_10bit:
-            acceleration[ii] = LIS2DH12_FROM_FS_16g_NM_TO_mg(raw_acceleration->i16bit[ii]);
-            break;
-
-          case LIS2DH12_HR_12bit:
-            acceleration[ii] = LIS2DH12_FROM_FS_16g_HR_TO_mg(raw_acceleration->i16bit[ii]);
-            break;
-
-          default:
-            acceleration[ii] = RUUVI_INTERFACE_ACCELERATION_INVALID;
-            err_code |= RUUVI_DRIVER_ERROR_INTERNAL;
-            break;
-        }
-      break;
+  // Read back from RAM, registers are known.
+  err_code |= lis2dh12_odr_to_samplerate(p_dev->samplerate, &(config->samplerate));
+  err_code |= lis2dh12_mode_to_resolution(p_dev->resolution, &(config->resolution));
+  err_code |= lis2dh12_fs_to_scale(p_dev->scale, &(config->scale));
+  config->dsp_function = high_pass ? RUUVI_DRIVER_SENSOR_DSP_HIGH_PASS : RUUVI_DRIVER_SENSOR_DSP_LAST;
+  err_code |= lis2dh12_hpcf_to_parameter(ctrl_reg2.hpcf, &(config->dsp_parameter));
+  err_code |= ruuvi_interface_lis2dh12_mode_get(&(config->mode));
+  return err_code;
+}
 
-      default:
-        acceleration[ii] = RUUVI_INTERFACE_ACCELERATION_INVALID;
-        err_code |= RUUVI_DRIVER_ERROR_INTERNAL;
-        break;
-    }
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_configuration_set(const ruuvi_driver_sensor_t* sensor, ruuvi_driver_sensor_configuration_t* config)
+{
+  if(NULL == sensor || NULL == config) { return RUUVI_DRIVER_ERROR_NULL; }
+  // Sensor interface is identified by the functions bound to its slot.
+  uint8_t slot = 0;
+  while(RUUVI_INTERFACE_LIS2DH12_INSTANCES > slot
+        && (NULL == instances[slot] || bindings[slot].mode_set != sensor->mode_set))
+  {
+    slot++;
   }
+  if(RUUVI_INTERFACE_LIS2DH12_INSTANCES == slot) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  ruuvi_interface_lis2dh12_dev_t* const previous = lis2dh12_slot_select(slot);
+  ruuvi_driver_status_t err_code = lis2dh12_configuration_apply(config);
+  p_dev = previous;
   return err_code;
 }
 
+/**
+ * Convert a block of raw values to acceleration in g
+ *
+ * parameter raw: Input. Array of raw values from LIS2DH12
+ * parameter acceleration: Output. Acceleration values in g, 3 * count floats in X, Y, Z order
+ * parameter count: Number of elements in raw
+ *
+ */
+static ruuvi_driver_status_t raw_to_g(const axis3bit16_t* const raw_acceleration, float* const acceleration, const size_t count)
+{
+  if(0 == p_dev->g_per_lsb) { return RUUVI_DRIVER_ERROR_INTERNAL; }
+
+  // Plain loop over interleaved axes, no per-sample branching.
+  const int16_t* const raw = raw_acceleration[0].i16bit;
+  const uint8_t shift = p_dev->shift;
+  const float g_per_lsb = p_dev->g_per_lsb;
+  for(size_t ii = 0; ii < (count * 3); ii++)
+  {
+    acceleration[ii] = (float)(raw[ii] >> shift) * g_per_lsb;
+  }
+  return RUUVI_DRIVER_SUCCESS;
+}
+
 ruuvi_driver_status_t ruuvi_interface_lis2dh12_data_get(void* data)
 {
   if(NULL == data) { return RUUVI_DRIVER_ERROR_NULL; }
@@ -693,7 +1161,6 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_data_get(void* data)
   ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
   axis3bit16_t raw_acceleration;
   memset(raw_acceleration.u8bit, 0x00, 3*sizeof(int16_t));
-  err_code |= lis2dh12_acceleration_raw_get(&(dev.ctx), raw_acceleration.u8bit);
 
   ruuvi_interface_acceleration_data_t* p_acceleration = (ruuvi_interface_acceleration_data_t*)data;
   float acceleration[3] = {0};
@@ -703,22 +1170,92 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_data_get(void* data)
   p_acceleration->y_g = RUUVI_INTERFACE_ACCELERATION_INVALID;
   p_acceleration->z_g = RUUVI_INTERFACE_ACCELERATION_INVALID;
 
-  // Compensate data with resolution, scale
-  err_code |= rawToMg(&raw_acceleration, acceleration);
-
+  // Return latched single sample while sleeping, leave data invalid while single sample is ongoing.
   uint8_t mode;
   err_code |= ruuvi_interface_lis2dh12_mode_get(&mode);
-  if(RUUVI_DRIVER_SENSOR_CFG_SLEEP == mode)           {  p_acceleration->timestamp_ms   = dev.tsample; }
-  else if(RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS == mode) {  p_acceleration->timestamp_ms   = ruuvi_driver_sensor_timestamp_get(); }
+  if(RUUVI_DRIVER_SENSOR_CFG_SLEEP == mode)
+  {
+    raw_acceleration = p_dev->latched;
+    p_acceleration->timestamp_ms = p_dev->tsample;
+  }
+  else if(RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS == mode)
+  {
+    err_code |= lis2dh12_acceleration_raw_get(&(p_dev->ctx), raw_acceleration.u8bit);
+    p_acceleration->timestamp_ms = ruuvi_driver_sensor_timestamp_get();
+  }
+  else if(RUUVI_DRIVER_SENSOR_CFG_SINGLE == mode) { return err_code; }
   else { RUUVI_DRIVER_ERROR_CHECK(RUUVI_DRIVER_ERROR_INTERNAL, ~RUUVI_DRIVER_ERROR_FATAL); }
 
+  // Compensate data with resolution, scale
+  err_code |= raw_to_g(&raw_acceleration, acceleration, 1);
+
   // If we have valid data, return it.
   if(RUUVI_DRIVER_UINT64_INVALID != p_acceleration->timestamp_ms && RUUVI_DRIVER_SUCCESS == err_code)
   {
-    //Convert mG to G
-    p_acceleration->x_g = acceleration[0] / 1000;
-    p_acceleration->y_g = acceleration[1] / 1000;
-    p_acceleration->z_g = acceleration[2] / 1000;
+    p_acceleration->x_g = acceleration[0];
+    p_acceleration->y_g = acceleration[1];
+    p_acceleration->z_g = acceleration[2];
+  }
+  return err_code;
+}
+
+// Asynchronous single sample is ready, latch it and notify application. Runs in scheduler context.
+static void lis2dh12_single_task(void* p_event_data, uint16_t event_size)
+{
+  if(NULL == p_event_data || sizeof(uint8_t) != event_size) { return; }
+  // Sample was aborted, or aborted and started again, after timer expired.
+  if(NULL == p_single_dev || single_sequence != *((uint8_t*)p_event_data)) { return; }
+  ruuvi_interface_lis2dh12_dev_t* const previous = p_dev;
+  p_dev = p_single_dev;
+  p_single_dev = NULL;
+  ruuvi_interface_lis2dh12_sample_cb_t callback = p_dev->single_cb;
+  p_dev->single_cb = NULL;
+  ruuvi_driver_status_t err_code = lis2dh12_single_latch();
+  RUUVI_DRIVER_ERROR_CHECK(err_code, ~RUUVI_DRIVER_ERROR_FATAL);
+
+  // Data is left invalid if latching failed
+  ruuvi_interface_acceleration_data_t data;
+  ruuvi_interface_lis2dh12_data_get(&data);
+  p_dev = previous;
+  if(NULL != callback) { callback(&data); }
+}
+
+// Turn-on time has elapsed, defer the bus access to scheduler.
+static void lis2dh12_single_timeout_handler(void* p_context)
+{
+  uint8_t sequence = single_sequence;
+  ruuvi_platform_scheduler_event_put(&sequence, sizeof(sequence), lis2dh12_single_task);
+}
+
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_single_async(const ruuvi_interface_lis2dh12_sample_cb_t callback)
+{
+  if(NULL == callback) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(NULL == p_dev->ctx.write_reg) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  // Timer is shared by instances
+  if(NULL != p_single_dev) { return RUUVI_DRIVER_ERROR_BUSY; }
+  if(RUUVI_DRIVER_SENSOR_CFG_SLEEP != p_dev->mode) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  if(!single_timer_created)
+  {
+    err_code |= ruuvi_platform_timer_create(&lis2dh12_single_timer, RUUVI_INTERFACE_TIMER_MODE_SINGLE_SHOT, lis2dh12_single_timeout_handler);
+    if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+    single_timer_created = true;
+  }
+
+  // Start sensor at 400 Hz, sample gets latched once turn-on time has elapsed.
+  p_dev->single_cb = callback;
+  p_dev->mode = RUUVI_DRIVER_SENSOR_CFG_SINGLE;
+  p_single_dev = p_dev;
+  single_sequence++;
+  err_code |= lis2dh12_data_rate_set(&(p_dev->ctx), LIS2DH12_ODR_400Hz);
+  err_code |= ruuvi_platform_timer_start(lis2dh12_single_timer, LIS2DH12_SINGLE_SAMPLE_DELAY_MS);
+  if(RUUVI_DRIVER_SUCCESS != err_code)
+  {
+    p_dev->single_cb = NULL;
+    p_dev->mode = RUUVI_DRIVER_SENSOR_CFG_SLEEP;
+    p_single_dev = NULL;
+    lis2dh12_data_rate_set(&(p_dev->ctx), LIS2DH12_POWER_DOWN);
   }
   return err_code;
 }
@@ -729,22 +1266,61 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_use(const bool enable)
   lis2dh12_fm_t mode;
   if(enable) { mode = LIS2DH12_DYNAMIC_STREAM_MODE; }
   else { mode = LIS2DH12_BYPASS_MODE; }
-  lis2dh12_fifo_set(&(dev.ctx), enable);
-  return lis2dh12_fifo_mode_set(&(dev.ctx),  mode);
+  lis2dh12_fifo_set(&(p_dev->ctx), enable);
+  return lis2dh12_fifo_mode_set(&(p_dev->ctx),  mode);
+}
+
+/**
+ * Fill description of raw data from cached configuration.
+ * Does not access the sensor.
+ */
+static ruuvi_driver_status_t lis2dh12_raw_info_fill(ruuvi_interface_acceleration_raw_info_t* const info)
+{
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  info->samplerate_hz = lis2dh12_odr_to_hz(p_dev->samplerate);
+  info->shift         = p_dev->shift;
+  info->g_per_lsb     = p_dev->g_per_lsb;
+  switch(p_dev->scale)
+  {
+    case LIS2DH12_2g:
+      info->scale_g = 2;
+      break;
+
+    case LIS2DH12_4g:
+      info->scale_g = 4;
+      break;
+
+    case LIS2DH12_8g:
+      info->scale_g = 8;
+      break;
+
+    case LIS2DH12_16g:
+      info->scale_g = 16;
+      break;
+
+    default:
+      info->scale_g = RUUVI_DRIVER_SENSOR_ERR_INVALID;
+      err_code |= RUUVI_DRIVER_ERROR_INTERNAL;
+      break;
+  }
+  // Resolution is the number of bits left after the shift.
+  info->resolution = 16 - p_dev->shift;
+  if(0 == info->samplerate_hz || 0 == p_dev->g_per_lsb) { err_code |= RUUVI_DRIVER_ERROR_INTERNAL; }
+  return err_code;
 }
 
 //TODO * return: RUUVI_DRIVER_INVALID_STATE if FIFO is not in use
-ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_read(size_t* num_elements, ruuvi_interface_acceleration_data_t* data)
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_read_raw(size_t* num_elements, int16_t* raw, ruuvi_interface_acceleration_raw_info_t* info)
 {
-  if(NULL == num_elements || NULL == data) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(NULL == num_elements || NULL == raw || NULL == info) { return RUUVI_DRIVER_ERROR_NULL; }
 
   uint8_t elements = 0;
   ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
-  err_code |= lis2dh12_fifo_data_level_get(&(dev.ctx), &elements);
+  err_code |= lis2dh12_fifo_data_level_get(&(p_dev->ctx), &elements);
   if(!elements)
   {
     *num_elements = 0;
-    return RUUVI_DRIVER_SUCCESS;
+    return err_code;
   }
   // 31 FIFO + latest
   elements++;
@@ -752,26 +1328,42 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_read(size_t* num_elements, r
   // Do not read more than buffer size
   if(elements > *num_elements) { elements = *num_elements; }
 
-  // get current time
-  uint64_t now = ruuvi_driver_sensor_timestamp_get();
-  // Get samplerate
-  uint8_t rate;
-  ruuvi_interface_lis2dh12_samplerate_get(&rate);
-  // Calculate sample interval
-  uint32_t interval = 1000 / rate;
+  // Last element of block is the latest sample
+  info->timestamp_ms = ruuvi_driver_sensor_timestamp_get();
+  err_code |= lis2dh12_raw_info_fill(info);
 
-  // Read all elements
-  axis3bit16_t raw_acceleration;
-  float acceleration[3];
+  // Read all elements in one burst. Register address auto-increments from OUT_X_L to OUT_Z_H and
+  // wraps back to OUT_X_L while FIFO is enabled, so each 6-byte frame pops one element.
+  err_code |= lis2dh12_read_reg(&(p_dev->ctx), LIS2DH12_OUT_X_L, (uint8_t*)raw, elements * sizeof(axis3bit16_t));
+  *num_elements = elements;
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_read(size_t* num_elements, ruuvi_interface_acceleration_data_t* data)
+{
+  if(NULL == num_elements || NULL == data) { return RUUVI_DRIVER_ERROR_NULL; }
+
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  axis3bit16_t raw_acceleration[RUUVI_INTERFACE_LIS2DH12_FIFO_SIZE];
+  ruuvi_interface_acceleration_raw_info_t info;
+  size_t elements = RUUVI_INTERFACE_LIS2DH12_FIFO_SIZE;
+  if(elements > *num_elements) { elements = *num_elements; }
+  err_code |= ruuvi_interface_lis2dh12_fifo_read_raw(&elements, raw_acceleration[0].i16bit, &info);
+  if(!elements || RUUVI_DRIVER_SUCCESS != err_code)
+  {
+    *num_elements = 0;
+    return err_code;
+  }
+
+  // Compensate data with resolution, scale
+  float acceleration[RUUVI_INTERFACE_LIS2DH12_FIFO_SIZE * 3];
+  err_code |= raw_to_g(raw_acceleration, acceleration, elements);
   for(size_t ii = 0; ii < elements; ii++)
   {
-    err_code |= lis2dh12_acceleration_raw_get(&(dev.ctx), raw_acceleration.u8bit);
-    // Compensate data with resolution, scale
-    err_code |= rawToMg(&raw_acceleration, acceleration);
-    data[ii].timestamp_ms = now - ((elements-ii-1)*interval);
-    data[ii].x_g = acceleration[0] / 1000;
-    data[ii].y_g = acceleration[1] / 1000;
-    data[ii].z_g = acceleration[2] / 1000;
+    data[ii].timestamp_ms = info.timestamp_ms - (((elements-ii-1) * 1000) / info.samplerate_hz);
+    data[ii].x_g = acceleration[(ii * 3) + 0];
+    data[ii].y_g = acceleration[(ii * 3) + 1];
+    data[ii].z_g = acceleration[(ii * 3) + 2];
   }
   *num_elements = elements;
   return err_code;
@@ -782,18 +1374,169 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_interrupt_use(const bool ena
 {
   ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
   lis2dh12_ctrl_reg3_t ctrl = { 0 };
+  // Keep other interrupts routed to INT1
+  err_code |= lis2dh12_pin_int1_config_get(&(p_dev->ctx), &ctrl);
+  ctrl.i1_wtm = PROPERTY_DISABLE;
   if(true == enable)
   {
     // Setting the FTH [4:0] bit in the FIFO_CTRL_REG (2Eh) register to an N value,
     // the number of X, Y and Z data samples that should be read at the rise of the watermark interrupt is up to (N+1).
-    err_code |= lis2dh12_fifo_watermark_set(&(dev.ctx), 31);
+    err_code |= lis2dh12_fifo_watermark_set(&(p_dev->ctx), p_dev->watermark);
     ctrl.i1_wtm = PROPERTY_ENABLE;
+  }
+  err_code |= lis2dh12_pin_int1_config_set(&(p_dev->ctx), &ctrl);
+  return err_code;
+}
 
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_watermark_set(uint8_t* watermark)
+{
+  if(NULL == watermark) { return RUUVI_DRIVER_ERROR_NULL; }
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+
+  if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == *watermark)    { }
+  else if(RUUVI_DRIVER_SENSOR_CFG_MIN == *watermark)     { p_dev->watermark = 1; }
+  else if(RUUVI_DRIVER_SENSOR_CFG_MAX == *watermark)     { p_dev->watermark = RUUVI_INTERFACE_LIS2DH12_FIFO_SIZE - 1; }
+  else if(RUUVI_DRIVER_SENSOR_CFG_DEFAULT == *watermark) { p_dev->watermark = RUUVI_INTERFACE_LIS2DH12_DEFAULT_WATERMARK; }
+  else if(RUUVI_INTERFACE_LIS2DH12_FIFO_SIZE > *watermark) { p_dev->watermark = *watermark; }
+  else
+  {
+    *watermark = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED;
+    return RUUVI_DRIVER_ERROR_NOT_SUPPORTED;
   }
-  err_code |= lis2dh12_pin_int1_config_set(&(dev.ctx), &ctrl);
+
+  err_code |= lis2dh12_fifo_watermark_set(&(p_dev->ctx), p_dev->watermark);
+  *watermark = p_dev->watermark;
   return err_code;
 }
 
+// Copy drained samples to ring, drop samples which do not fit.
+static void lis2dh12_ring_push(ruuvi_interface_lis2dh12_fifo_ring_t* const ring, const int16_t* const raw, const size_t count)
+{
+  size_t head = ring->head;
+  size_t space = ring->capacity - (head - ring->tail);
+  size_t to_copy = (count > space) ? space : count;
+  for(size_t ii = 0; ii < to_copy; ii++)
+  {
+    size_t index = ((head + ii) & (ring->capacity - 1)) * 3;
+    ring->samples[index + 0] = raw[(ii * 3) + 0];
+    ring->samples[index + 1] = raw[(ii * 3) + 1];
+    ring->samples[index + 2] = raw[(ii * 3) + 2];
+  }
+  ring->overflows += count - to_copy;
+  ring->head = head + to_copy;
+}
+
+// Drain FIFO of instance in slot given as event data into ring buffer. Runs in scheduler context.
+static void lis2dh12_fifo_drain_task(void* p_event_data, uint16_t event_size)
+{
+  if(NULL == p_event_data || sizeof(uint8_t) != event_size) { return; }
+  uint8_t slot = *((uint8_t*)p_event_data);
+  if(RUUVI_INTERFACE_LIS2DH12_INSTANCES <= slot || NULL == instances[slot]) { return; }
+  ruuvi_interface_lis2dh12_fifo_ring_t* const ring = instances[slot]->p_ring;
+  if(NULL == ring) { return; }
+  ruuvi_interface_lis2dh12_dev_t* const previous = lis2dh12_slot_select(slot);
+
+  axis3bit16_t raw_acceleration[RUUVI_INTERFACE_LIS2DH12_FIFO_SIZE];
+  ruuvi_interface_acceleration_raw_info_t info;
+  size_t elements = RUUVI_INTERFACE_LIS2DH12_FIFO_SIZE;
+  ruuvi_driver_status_t err_code = ruuvi_interface_lis2dh12_fifo_read_raw(&elements, raw_acceleration[0].i16bit, &info);
+  p_dev = previous;
+  RUUVI_DRIVER_ERROR_CHECK(err_code, ~RUUVI_DRIVER_ERROR_FATAL);
+  if(RUUVI_DRIVER_SUCCESS != err_code || 0 == elements) { return; }
+
+  // Samples dropped from the newest end shift the timestamp of the last stored sample back.
+  size_t space = ring->capacity - (ring->head - ring->tail);
+  if(elements > space)
+  {
+    info.timestamp_ms -= ((elements - space) * 1000) / info.samplerate_hz;
+  }
+  ring->info = info;
+  lis2dh12_ring_push(ring, raw_acceleration[0].i16bit, elements);
+}
+
+// Watermark interrupt, find instance wired to pin and defer the bus access to scheduler.
+static void lis2dh12_fifo_wtm_isr(const ruuvi_interface_gpio_evt_t event)
+{
+  for(uint8_t slot = 0; slot < RUUVI_INTERFACE_LIS2DH12_INSTANCES; slot++)
+  {
+    if(NULL != instances[slot] && NULL != instances[slot]->p_ring && event.pin == instances[slot]->drain_pin)
+    {
+      ruuvi_platform_scheduler_event_put(&slot, sizeof(slot), lis2dh12_fifo_drain_task);
+    }
+  }
+}
+
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_drain_start(const uint8_t pin, ruuvi_interface_lis2dh12_fifo_ring_t* const ring)
+{
+  if(NULL == ring || NULL == ring->samples) { return RUUVI_DRIVER_ERROR_NULL; }
+  // Capacity must be a power of two
+  if(0 == ring->capacity || (ring->capacity & (ring->capacity - 1))) { return RUUVI_DRIVER_ERROR_INVALID_LENGTH; }
+  if(NULL != p_dev->p_ring) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  ring->head = 0;
+  ring->tail = 0;
+  ring->overflows = 0;
+  memset(&(ring->info), 0, sizeof(ring->info));
+  p_dev->p_ring = ring;
+  p_dev->drain_pin = pin;
+
+  err_code |= ruuvi_platform_gpio_interrupt_enable(pin,
+                                                   RUUVI_INTERFACE_GPIO_SLOPE_LOTOHI,
+                                                   RUUVI_INTERFACE_GPIO_MODE_INPUT_NOPULL,
+                                                   lis2dh12_fifo_wtm_isr);
+  // Pin may be in use by another module, leave it as it is.
+  if(RUUVI_DRIVER_SUCCESS != err_code)
+  {
+    p_dev->p_ring = NULL;
+    return err_code;
+  }
+  err_code |= ruuvi_interface_lis2dh12_fifo_use(true);
+  err_code |= ruuvi_interface_lis2dh12_fifo_interrupt_use(true);
+  if(RUUVI_DRIVER_SUCCESS != err_code)
+  {
+    ruuvi_platform_gpio_interrupt_disable(pin);
+    p_dev->p_ring = NULL;
+  }
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_drain_stop(void)
+{
+  if(NULL == p_dev->p_ring) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  p_dev->p_ring = NULL;
+  ruuvi_driver_status_t err_code = ruuvi_platform_gpio_interrupt_disable(p_dev->drain_pin);
+  err_code |= ruuvi_interface_lis2dh12_fifo_interrupt_use(false);
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_ring_read(ruuvi_interface_lis2dh12_fifo_ring_t* const ring, size_t* const num_elements, int16_t* const raw, ruuvi_interface_acceleration_raw_info_t* const info)
+{
+  if(NULL == ring || NULL == num_elements || NULL == raw || NULL == info) { return RUUVI_DRIVER_ERROR_NULL; }
+
+  size_t head = ring->head;
+  size_t tail = ring->tail;
+  size_t available = head - tail;
+  size_t elements = (*num_elements > available) ? available : *num_elements;
+  for(size_t ii = 0; ii < elements; ii++)
+  {
+    size_t index = ((tail + ii) & (ring->capacity - 1)) * 3;
+    raw[(ii * 3) + 0] = ring->samples[index + 0];
+    raw[(ii * 3) + 1] = ring->samples[index + 1];
+    raw[(ii * 3) + 2] = ring->samples[index + 2];
+  }
+
+  // Block timestamp is the time of the last sample read, count back from latest sample in ring
+  *info = ring->info;
+  if(0 != info->samplerate_hz)
+  {
+    info->timestamp_ms -= ((available - elements) * 1000) / info->samplerate_hz;
+  }
+  ring->tail = tail + elements;
+  *num_elements = elements;
+  return (available > elements) ? RUUVI_DRIVER_STATUS_MORE_AVAILABLE : RUUVI_DRIVER_SUCCESS;
+}
+
 /**
  * Enable activity interrupt on LIS2DH12
  * Triggers as ACTIVE HIGH interrupt while detected movement is above threshold limit_g
@@ -867,16 +1610,16 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_activity_interrupt_use(const bool
   *limit_g = threshold*divisor;
 
   // Configure highpass on INTERRUPT 1
-  err_code |= lis2dh12_high_pass_int_conf_set(&(dev.ctx), high_pass);
+  err_code |= lis2dh12_high_pass_int_conf_set(&(p_dev->ctx), high_pass);
 
   // Configure INTERRUPT 1 Threshold
-  err_code |= lis2dh12_int1_gen_threshold_set(&(dev.ctx), threshold);
+  err_code |= lis2dh12_int1_gen_threshold_set(&(p_dev->ctx), threshold);
 
   // Configure INTERRUPT 1 ON ZHI, ZLO, YHI, YLO, XHI, XLO
-  err_code |= lis2dh12_int1_gen_conf_set(&(dev.ctx), &cfg);
+  err_code |= lis2dh12_int1_gen_conf_set(&(p_dev->ctx), &cfg);
 
   // Route INTERRUPT 1 to PIN 2
-  err_code |= lis2dh12_pin_int2_config_set(&(dev.ctx), &ctrl6);
+  err_code |= lis2dh12_pin_int2_config_set(&(p_dev->ctx), &ctrl6);
 
   return err_code;
 }
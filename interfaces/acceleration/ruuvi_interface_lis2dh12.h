@@ -9,21 +9,208 @@
 #define RUUVI_INTERFACE_LIS2DH12_H
 #include "ruuvi_driver_error.h"
 #include "ruuvi_driver_sensor.h"
+#include "ruuvi_interface_acceleration.h"
+
+#include "lis2dh12_reg.h"
 
 #include <stdbool.h>
 #include <stddef.h>
 #include <stddef.h>
 
+// Number of LIS2DH12 instances which can be initialized at the same time, up to 4.
+#ifndef RUUVI_INTERFACE_LIS2DH12_INSTANCES
+  #define RUUVI_INTERFACE_LIS2DH12_INSTANCES 2
+#endif
+
 // Counts of self-test change in 10 bit resolution 2 G scale, datasheet.
 #define RUUVI_INTERFACE_LIS2DH12_SELFTEST_DIFF_MIN 17
 #define RUUVI_INTERFACE_LIS2DH12_SELFTEST_DIFF_MAX 360
 #define RUUVI_INTERFACE_LIS2DH12_DEFAULT_SCALE 2
 #define RUUVI_INTERFACE_LIS2DH12_DEFAULT_RESOLUTION 10
+#define RUUVI_INTERFACE_LIS2DH12_FIFO_SIZE 32
+#define RUUVI_INTERFACE_LIS2DH12_DEFAULT_WATERMARK 31
+#define RUUVI_INTERFACE_LIS2DH12_SELFTEST_CACHE_KEY 0x4C495332 // "LIS2"
+#define RUUVI_INTERFACE_LIS2DH12_SELFTEST_PASSED 0xA5
+
+/**
+ * Ring buffer of raw samples filled from FIFO on watermark interrupt.
+ * Storage is given by application. Drain is the only writer of head and the consumer the only writer of tail.
+ */
+typedef struct
+{
+  int16_t* samples;       // 3 * capacity int16_t, X, Y, Z triplets
+  size_t capacity;        // Number of triplets, must be a power of two
+  volatile size_t head;   // Free-running write counter
+  volatile size_t tail;   // Free-running read counter
+  uint32_t overflows;     // Number of samples dropped because ring was full
+  ruuvi_interface_acceleration_raw_info_t info; // Description of latest sample in ring
+}ruuvi_interface_lis2dh12_fifo_ring_t;
+
+/**
+ * Self-test verdict kept over warm boots in retained RAM or flash.
+ * Entry is valid if key is RUUVI_INTERFACE_LIS2DH12_SELFTEST_CACHE_KEY and check matches the other fields,
+ * so uninitialized memory after a cold boot is not mistaken for a passed self-test.
+ */
+typedef struct {
+  uint32_t key;    // RUUVI_INTERFACE_LIS2DH12_SELFTEST_CACHE_KEY
+  uint8_t handle;  // Chip select of sensor
+  uint8_t verdict; // RUUVI_INTERFACE_LIS2DH12_SELFTEST_PASSED
+  uint32_t check;  // Check of other fields
+}ruuvi_interface_lis2dh12_selftest_cache_t;
+
+/**
+ * Called when asynchronous single sample is ready.
+ */
+typedef void(*ruuvi_interface_lis2dh12_sample_cb_t)(const ruuvi_interface_acceleration_data_t* const data);
+
+/**
+ * State of one LIS2DH12. Storage is given by application, contents are managed by driver.
+ */
+typedef struct {
+  // resolution
+  lis2dh12_op_md_t resolution;
+
+  // scale
+  lis2dh12_fs_t scale;
+
+  // data rate
+  lis2dh12_odr_t samplerate;
+
+  // self-test
+  lis2dh12_st_t selftest;
+
+  // operating mode, handle
+  uint8_t mode, handle;
+
+  uint64_t tsample; // Time of last sample in single mode.
+  axis3bit16_t latched; // Last sample in single mode.
+  ruuvi_interface_lis2dh12_sample_cb_t single_cb; // Called when asynchronous single sample is ready.
+
+  // Conversion from raw to g, updated on scale and resolution change
+  float g_per_lsb;
+  uint8_t shift;
+
+  // FIFO watermark level and ring buffer drained on watermark interrupt of drain_pin
+  uint8_t watermark;
+  uint8_t drain_pin;
+  ruuvi_interface_lis2dh12_fifo_ring_t* p_ring;
+
+  // device control structure
+  lis2dh12_ctx_t ctx;
+}ruuvi_interface_lis2dh12_dev_t;
 
 ruuvi_driver_status_t ruuvi_interface_lis2dh12_init(ruuvi_driver_sensor_t* acceleration_sensor, ruuvi_driver_bus_t bus, uint8_t handle);
+
+/**
+ * Give storage for self-test verdicts. Init skips the self-test of a sensor which has a passed verdict in cache,
+ * and stores the verdict after the self-test passes. Place the cache in memory which is retained over soft resets,
+ * or in flash, to skip the self-test delays on warm boots. Invalidate the cache, for example by clearing it,
+ * to run the self-test again.
+ *
+ * parameter cache: array of entries, NULL to stop using cache.
+ * parameter entries: number of entries in cache, one per sensor.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if cache is NULL and entries is not 0
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_selftest_cache_set(ruuvi_interface_lis2dh12_selftest_cache_t* const cache, const size_t entries);
 ruuvi_driver_status_t ruuvi_interface_lis2dh12_uninit(ruuvi_driver_sensor_t* acceleration_sensor, ruuvi_driver_bus_t bus, uint8_t handle);
+
+/**
+ * Apply whole configuration at once to the instance of sensor interface.
+ * Configuration is validated before the sensor is accessed, nothing is written if any value is invalid.
+ * Control registers are read in one transaction, and only the changed registers are written in one transaction.
+ * Applied configuration is written back to config from RAM without further bus access.
+ *
+ * parameter sensor: sensor interface initialized by this driver.
+ * parameter config: input: requested configuration. Output: applied configuration.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if sensor or config is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if sensor is not initialized by this driver
+ * return: RUUVI_DRIVER_ERROR_BUSY if asynchronous single sample is ongoing
+ * return: RUUVI_DRIVER_ERROR_NOT_SUPPORTED or RUUVI_DRIVER_ERROR_INVALID_PARAM if configuration is invalid
+ * return: error code from stack on error.
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_configuration_set(const ruuvi_driver_sensor_t* sensor, ruuvi_driver_sensor_configuration_t* config);
+
+/**
+ * Initialize LIS2DH12 with state stored in given instance.
+ * Several LIS2DH12 can share a bus, each is identified by its chip select handle.
+ * Function pointers of acceleration_sensor are bound to the instance, so sensors can be used one after another
+ * through their function pointers. ruuvi_interface_lis2dh12_init uses storage inside driver.
+ * Other ruuvi_interface_lis2dh12_ functions operate on the instance chosen with ruuvi_interface_lis2dh12_instance_select.
+ * Bound functions, initialization and the driver's own timers and interrupts do not change the selection,
+ * except that the first initialized instance is selected if no initialized instance was selected.
+ * Uninitialize with ruuvi_interface_lis2dh12_uninit and handle of the instance.
+ *
+ * parameter acceleration_sensor: sensor to bind to instance
+ * parameter bus: bus of the sensor
+ * parameter handle: chip select of the sensor
+ * parameter instance: storage of sensor state, must be valid until the sensor is uninitialized
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if sensor or instance is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if instance or handle is already initialized
+ * return: RUUVI_DRIVER_ERROR_RESOURCES if RUUVI_INTERFACE_LIS2DH12_INSTANCES are already initialized
+ * return: error code from stack on error.
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_instance_init(ruuvi_driver_sensor_t* acceleration_sensor, ruuvi_driver_bus_t bus, uint8_t handle, ruuvi_interface_lis2dh12_dev_t* const instance);
+
+/**
+ * Select instance ruuvi_interface_lis2dh12_ functions operate on.
+ *
+ * parameter handle: chip select of the sensor
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NOT_FOUND if there is no sensor initialized with handle
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_instance_select(const uint8_t handle);
+
+/**
+ * Get handle of instance ruuvi_interface_lis2dh12_ functions operate on,
+ * for example to restore the selection after operating on another instance.
+ *
+ * parameter handle: Output: chip select of the selected sensor
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if handle is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if selected instance is not initialized
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_instance_selected(uint8_t* const handle);
+
+/**
+ * Get STM driver context of selected instance for modules building on top of this driver.
+ * Context is valid until the instance is uninitialized.
+ *
+ * return: Pointer to context, NULL if selected instance is not initialized.
+ */
+lis2dh12_ctx_t* ruuvi_interface_lis2dh12_ctx_get(void);
+
 ruuvi_driver_status_t ruuvi_interface_lis2dh12_samplerate_set(uint8_t* samplerate);
 ruuvi_driver_status_t ruuvi_interface_lis2dh12_samplerate_get(uint8_t* samplerate);
+
+/**
+ * Set samplerate in Hz. Covers all output data rates of LIS2DH12, samplerate_set is limited to 200 Hz.
+ * 1620 Hz and 5376 Hz are available only at 8 bit resolution, 1344 Hz only at 10 and 12 bit resolutions.
+ * Samplerate is rounded up to next rate available at current resolution.
+ * Samplerate_get returns RUUVI_DRIVER_SENSOR_CFG_EXTENDED while samplerate is above 200 Hz.
+ *
+ * parameter samplerate: Input: Requested samplerate. Output: Samplerate that was set.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if samplerate is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if sensor is not in sleep mode
+ * return: RUUVI_DRIVER_ERROR_NOT_SUPPORTED if samplerate is 0 or higher than supported at current resolution
+ * return: error code from stack on error.
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_samplerate_hz_set(uint16_t* samplerate);
+
+/**
+ * Read samplerate in Hz.
+ *
+ * parameter samplerate: Output: Samplerate in Hz.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if samplerate is NULL
+ * return: RUUVI_DRIVER_ERROR_INTERNAL if sensor is powered down
+ * return: error code from stack on error.
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_samplerate_hz_get(uint16_t* samplerate);
+
 ruuvi_driver_status_t ruuvi_interface_lis2dh12_resolution_set(uint8_t* resolution);
 ruuvi_driver_status_t ruuvi_interface_lis2dh12_resolution_get(uint8_t* resolution);
 ruuvi_driver_status_t ruuvi_interface_lis2dh12_scale_set(uint8_t* scale);
@@ -34,6 +221,23 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_mode_set(uint8_t*);
 ruuvi_driver_status_t ruuvi_interface_lis2dh12_mode_get(uint8_t*);
 ruuvi_driver_status_t ruuvi_interface_lis2dh12_data_get(void* data);
 
+/**
+ * Take a single sample without blocking.
+ * Starts the sensor and returns immediately. Once the sensor turn-on time has elapsed, timer schedules
+ * the sample to be latched and passed to callback in scheduler context. Sensor is powered down after sampling.
+ * Mode is RUUVI_DRIVER_SENSOR_CFG_SINGLE while sample is ongoing and data_get returns invalid data.
+ * Setting mode to sleep aborts the sample. Timers and scheduler must be initialized.
+ * One instance at a time can sample asynchronously.
+ *
+ * parameter callback: function to call with the sample.
+ * return: RUUVI_DRIVER_SUCCESS if sample was started
+ * return: RUUVI_DRIVER_ERROR_NULL if callback is NULL
+ * return: RUUVI_DRIVER_ERROR_BUSY if sample is already ongoing
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if sensor is not initialized or is in continuous mode
+ * return: error code from stack on error.
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_single_async(const ruuvi_interface_lis2dh12_sample_cb_t callback);
+
 /**
  * Enable 32-level FIFO in LIS2DH12
  * If FIFO is enabled, values are stored on LIS2DH12 FIFO and oldest element is returned on data read.
@@ -45,7 +249,8 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_use(const bool enable);
 
 /**
  * Read FIFO
- * Reads up to num_elements data points from FIFO and populates pointer data with them
+ * Reads up to num_elements data points from FIFO and populates pointer data with them.
+ * FIFO level is read once and all elements are then read in a single burst transaction.
  *
  * parameter num_elements: Input: number of elements in data. Output: Number of elements placed in data
  * parameter data: array of ruuvi_interface_acceleration_data_t with num_elements slots.
@@ -57,14 +262,78 @@ ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_use(const bool enable);
 ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_read(size_t* num_elements, ruuvi_interface_acceleration_data_t* data);
 
 /**
- * Enable FIFO full interrupt on LIS2DH12.
- * Triggers as ACTIVE HIGH interrupt once FIFO has 32 elements.
+ * Read FIFO as raw samples
+ * Reads up to num_elements samples from FIFO as X, Y, Z int16_t triplets without converting them.
+ * Samples are left-justified as on sensor, use ruuvi_interface_acceleration_raw_to_g to convert them.
+ *
+ * parameter num_elements: Input: number of triplets raw has room for. Output: Number of triplets placed in raw
+ * parameter raw: array of 3 * num_elements int16_t.
+ * parameter info: Output. Timestamp of the last sample, samplerate, scale and resolution of the block.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if any parameter is NULL
+ * return: error code from stack on error.
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_read_raw(size_t* num_elements, int16_t* raw, ruuvi_interface_acceleration_raw_info_t* info);
+
+/**
+ * Enable FIFO watermark interrupt on LIS2DH12.
+ * Triggers as ACTIVE HIGH interrupt on INT1 once FIFO has more elements than the watermark, 31 by default.
  *
  * parameter enable: True to enable interrupt, false to disable interrupt
  * return: RUUVI_DRIVER_SUCCESS on success, error code from stack otherwise.
  **/
 ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_interrupt_use(const bool enable);
 
+/**
+ * Set FIFO watermark level. Watermark interrupt triggers once FIFO has more elements than watermark.
+ * Lower watermark gives lower latency at the cost of more frequent wakeups.
+ *
+ * parameter watermark: Input: 1 ... 31 or MIN, MAX, DEFAULT, NO_CHANGE. Output: level that was set.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if watermark is NULL
+ * return: RUUVI_DRIVER_ERROR_NOT_SUPPORTED if watermark is out of range
+ * return: error code from stack on error.
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_watermark_set(uint8_t* watermark);
+
+/**
+ * Start draining FIFO into ring buffer on watermark interrupt.
+ * Each instance must have its own interrupt pin.
+ * Enables FIFO and watermark interrupt on INT1, and interrupt on given GPIO pin.
+ * Interrupt schedules the drain with ruuvi_platform_scheduler_event_put, so scheduler and
+ * GPIO interrupts must be initialized.
+ *
+ * parameter pin: GPIO connected to LIS2DH12 INT1
+ * parameter ring: ring buffer to fill. Samples and capacity must be set, other fields are reset.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if ring or its storage is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_LENGTH if capacity is not a power of two
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if drain is already running
+ * return: error code from stack on error.
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_drain_start(const uint8_t pin, ruuvi_interface_lis2dh12_fifo_ring_t* const ring);
+
+/**
+ * Stop draining FIFO. Disables watermark interrupt and releases interrupt pin, FIFO is left enabled.
+ *
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if drain is not running
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_drain_stop(void);
+
+/**
+ * Read oldest samples from ring buffer.
+ *
+ * parameter ring: ring to read
+ * parameter num_elements: Input: number of triplets raw has room for. Output: Number of triplets placed in raw
+ * parameter raw: array of 3 * num_elements int16_t.
+ * parameter info: Output. Timestamp of the last sample read, samplerate, scale and resolution of the samples.
+ * return: RUUVI_DRIVER_SUCCESS if ring was emptied
+ * return: RUUVI_DRIVER_STATUS_MORE_AVAILABLE if there are samples left in ring
+ * return: RUUVI_DRIVER_ERROR_NULL if any parameter is NULL
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_fifo_ring_read(ruuvi_interface_lis2dh12_fifo_ring_t* const ring, size_t* const num_elements, int16_t* const raw, ruuvi_interface_acceleration_raw_info_t* const info);
+
 /**
  * Enable activity interrupt on LIS2DH12
  * Triggers as ACTIVE HIGH interrupt while detected movement is above threshold limit_g
@@ -0,0 +1,252 @@
+/**
+ * LIS2DH12 power mode governor.
+ * Switches sensor between idle and active profiles on activity interrupt and quiet timeout.
+ *
+ * License: BSD-3
+ * Author: Otso Jousimaa <otso@ojousima.net>
+ */
+
+#include "ruuvi_platform_external_includes.h"
+#if RUUVI_INTERFACE_ACCELERATION_LIS2DH12_ENABLED
+#include "ruuvi_driver_error.h"
+#include "ruuvi_driver_sensor.h"
+#include "ruuvi_interface_acceleration.h"
+#include "ruuvi_interface_gpio.h"
+#include "ruuvi_interface_gpio_interrupt.h"
+#include "ruuvi_interface_lis2dh12.h"
+#include "ruuvi_interface_lis2dh12_governor.h"
+#include "ruuvi_interface_lis2dh12_motion.h"
+#include "ruuvi_interface_scheduler.h"
+#include "ruuvi_interface_timer.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+RUUVI_PLATFORM_TIMER_ID_DEF(governor_quiet_timer);
+static bool quiet_timer_created = false;
+static uint8_t quiet_sequence = 0; // Incremented on quiet period restart, stale scheduled timeouts are ignored
+
+static struct {
+  ruuvi_interface_lis2dh12_governor_config_t config;
+  ruuvi_interface_lis2dh12_governor_state_t state;
+  uint8_t handle; // Chip select of governed sensor
+  bool running;
+}governor = {0};
+
+// Select governed sensor, previous selection is returned in previous and restored with governor_deselect.
+static ruuvi_driver_status_t governor_select(uint8_t* const previous)
+{
+  if(RUUVI_DRIVER_SUCCESS != ruuvi_interface_lis2dh12_instance_selected(previous)) { *previous = governor.handle; }
+  return ruuvi_interface_lis2dh12_instance_select(governor.handle);
+}
+
+static void governor_deselect(const uint8_t previous)
+{
+  ruuvi_interface_lis2dh12_instance_select(previous);
+}
+
+// Read FIFO until empty and give samples to application
+static ruuvi_driver_status_t governor_drain(void)
+{
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  int16_t raw[RUUVI_INTERFACE_LIS2DH12_FIFO_SIZE * 3];
+  ruuvi_interface_acceleration_raw_info_t info;
+  size_t elements;
+  do
+  {
+    elements = RUUVI_INTERFACE_LIS2DH12_FIFO_SIZE;
+    err_code |= ruuvi_interface_lis2dh12_fifo_read_raw(&elements, raw, &info);
+    if(RUUVI_DRIVER_SUCCESS == err_code && 0 < elements)
+    {
+      governor.config.callback(raw, elements, &info, governor.state);
+    }
+  } while(RUUVI_DRIVER_SUCCESS == err_code && RUUVI_INTERFACE_LIS2DH12_FIFO_SIZE == elements);
+  return err_code;
+}
+
+// Samplerate available at every resolution, used while resolution changes.
+#define GOVERNOR_NEUTRAL_SAMPLERATE_HZ 100
+
+/*
+ * Check that samplerate of profile is available at its resolution.
+ * 1620 and 5376 Hz require 8 bit resolution, 10 and 12 bit resolutions go up to 1344 Hz.
+ */
+static bool governor_profile_valid(const ruuvi_interface_lis2dh12_governor_profile_t* const profile)
+{
+  const bool low_power = (RUUVI_DRIVER_SENSOR_CFG_MIN == profile->resolution)
+                         || (RUUVI_DRIVER_SENSOR_CFG_DEFAULT != profile->resolution && 8 >= profile->resolution);
+  if(0 == profile->samplerate_hz) { return false; }
+  return profile->samplerate_hz <= (low_power ? 5376 : 1344);
+}
+
+/*
+ * Apply profile to sleeping sensor. Current samplerate may be unavailable at new resolution
+ * and vice versa, so sensor is put to a samplerate valid at every resolution before
+ * resolution is changed and the samplerate of profile is set last.
+ */
+static ruuvi_driver_status_t governor_profile_apply(const ruuvi_interface_lis2dh12_governor_profile_t* const profile)
+{
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  uint8_t resolution = profile->resolution;
+  uint8_t scale = profile->scale;
+  uint16_t samplerate = GOVERNOR_NEUTRAL_SAMPLERATE_HZ;
+  err_code |= ruuvi_interface_lis2dh12_samplerate_hz_set(&samplerate);
+  samplerate = profile->samplerate_hz;
+  err_code |= ruuvi_interface_lis2dh12_resolution_set(&resolution);
+  err_code |= ruuvi_interface_lis2dh12_scale_set(&scale);
+  err_code |= ruuvi_interface_lis2dh12_samplerate_hz_set(&samplerate);
+  return err_code;
+}
+
+static void governor_activity_handler(const ruuvi_interface_lis2dh12_motion_evt_t* const event);
+
+/*
+ * Switch to state. Sensor is stopped before FIFO is drained, so every sample taken
+ * in previous profile is delivered before the profile changes.
+ */
+static ruuvi_driver_status_t governor_transition(const ruuvi_interface_lis2dh12_governor_state_t state)
+{
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  uint8_t mode = RUUVI_DRIVER_SENSOR_CFG_SLEEP;
+  const ruuvi_interface_lis2dh12_governor_profile_t* const profile =
+    (RUUVI_INTERFACE_LIS2DH12_GOVERNOR_ACTIVE == state) ? &(governor.config.active) : &(governor.config.idle);
+
+  // Activity thresholds depend on scale and samplerate, disable detection until new profile is in use.
+  ruuvi_interface_lis2dh12_motion_disable();
+  err_code |= ruuvi_interface_lis2dh12_mode_set(&mode);
+  err_code |= governor_drain();
+  governor.state = state;
+  err_code |= governor_profile_apply(profile);
+
+  mode = RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS;
+  err_code |= ruuvi_interface_lis2dh12_mode_set(&mode);
+
+  ruuvi_interface_lis2dh12_motion_config_t motion = { 0 };
+  motion.activity_g = governor.config.activity_g;
+  motion.activity_ms = governor.config.activity_ms;
+  err_code |= ruuvi_interface_lis2dh12_motion_enable(governor.config.activity_pin, &motion, governor_activity_handler);
+  return err_code;
+}
+
+// Quiet period has passed without activity, switch to idle profile. Runs in scheduler context.
+static void governor_quiet_task(void* p_event_data, uint16_t event_size)
+{
+  if(!governor.running || RUUVI_INTERFACE_LIS2DH12_GOVERNOR_IDLE == governor.state) { return; }
+  // Activity restarted quiet period after timer expired
+  if(NULL == p_event_data || sizeof(uint8_t) != event_size || quiet_sequence != *((uint8_t*)p_event_data)) { return; }
+  uint8_t previous;
+  ruuvi_driver_status_t err_code = governor_select(&previous);
+  err_code |= governor_transition(RUUVI_INTERFACE_LIS2DH12_GOVERNOR_IDLE);
+  governor_deselect(previous);
+  RUUVI_DRIVER_ERROR_CHECK(err_code, ~RUUVI_DRIVER_ERROR_FATAL);
+}
+
+// Quiet timer, defer the bus access to scheduler.
+static void governor_quiet_timeout_handler(void* p_context)
+{
+  if(!governor.running) { return; }
+  uint8_t sequence = quiet_sequence;
+  ruuvi_platform_scheduler_event_put(&sequence, sizeof(sequence), governor_quiet_task);
+}
+
+// Activity detected, switch to active profile if idle and restart quiet period. Runs in scheduler context.
+static void governor_activity_handler(const ruuvi_interface_lis2dh12_motion_evt_t* const event)
+{
+  if(!governor.running || !(RUUVI_INTERFACE_LIS2DH12_MOTION_ACTIVITY & event->events)) { return; }
+  uint8_t previous;
+  ruuvi_driver_status_t err_code = governor_select(&previous);
+  if(RUUVI_INTERFACE_LIS2DH12_GOVERNOR_IDLE == governor.state)
+  {
+    err_code |= governor_transition(RUUVI_INTERFACE_LIS2DH12_GOVERNOR_ACTIVE);
+  }
+  governor_deselect(previous);
+  // Timer start is ignored if timer is running, stop it first.
+  err_code |= ruuvi_platform_timer_stop(governor_quiet_timer);
+  quiet_sequence++;
+  err_code |= ruuvi_platform_timer_start(governor_quiet_timer, governor.config.quiet_ms);
+  RUUVI_DRIVER_ERROR_CHECK(err_code, ~RUUVI_DRIVER_ERROR_FATAL);
+}
+
+// Drain FIFO. Runs in scheduler context.
+static void governor_drain_task(void* p_event_data, uint16_t event_size)
+{
+  if(!governor.running) { return; }
+  uint8_t previous;
+  ruuvi_driver_status_t err_code = governor_select(&previous);
+  err_code |= governor_drain();
+  governor_deselect(previous);
+  RUUVI_DRIVER_ERROR_CHECK(err_code, ~RUUVI_DRIVER_ERROR_FATAL);
+}
+
+// Watermark interrupt, defer the bus access to scheduler.
+static void governor_wtm_isr(const ruuvi_interface_gpio_evt_t event)
+{
+  if(!governor.running) { return; }
+  ruuvi_platform_scheduler_event_put(NULL, 0, governor_drain_task);
+}
+
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_governor_start(const ruuvi_interface_lis2dh12_governor_config_t* const config)
+{
+  if(NULL == config || NULL == config->callback) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(!governor_profile_valid(&(config->idle)) || !governor_profile_valid(&(config->active))) { return RUUVI_DRIVER_ERROR_INVALID_PARAM; }
+  if(governor.running) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  lis2dh12_ctx_t* const ctx = ruuvi_interface_lis2dh12_ctx_get();
+  if(NULL == ctx) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  uint8_t mode;
+  ruuvi_interface_lis2dh12_mode_get(&mode);
+  if(RUUVI_DRIVER_SENSOR_CFG_SLEEP != mode) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  if(!quiet_timer_created)
+  {
+    err_code |= ruuvi_platform_timer_create(&governor_quiet_timer, RUUVI_INTERFACE_TIMER_MODE_SINGLE_SHOT, governor_quiet_timeout_handler);
+    if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+    quiet_timer_created = true;
+  }
+
+  // Register pin first, stop releases it on any later error.
+  err_code |= ruuvi_platform_gpio_interrupt_enable(config->fifo_pin,
+                                                   RUUVI_INTERFACE_GPIO_SLOPE_LOTOHI,
+                                                   RUUVI_INTERFACE_GPIO_MODE_INPUT_NOPULL,
+                                                   governor_wtm_isr);
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+
+  governor.config = *config;
+  governor.handle = *((uint8_t*)ctx->handle);
+  governor.state = RUUVI_INTERFACE_LIS2DH12_GOVERNOR_IDLE;
+  governor.running = true;
+
+  err_code |= ruuvi_interface_lis2dh12_fifo_use(true);
+  err_code |= ruuvi_interface_lis2dh12_fifo_interrupt_use(true);
+  err_code |= governor_transition(RUUVI_INTERFACE_LIS2DH12_GOVERNOR_IDLE);
+  if(RUUVI_DRIVER_SUCCESS != err_code) { ruuvi_interface_lis2dh12_governor_stop(); }
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_governor_stop(void)
+{
+  if(!governor.running) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  uint8_t previous;
+  ruuvi_driver_status_t err_code = governor_select(&previous);
+  uint8_t mode = RUUVI_DRIVER_SENSOR_CFG_SLEEP;
+  err_code |= ruuvi_platform_timer_stop(governor_quiet_timer);
+  ruuvi_interface_lis2dh12_motion_disable();
+  err_code |= ruuvi_interface_lis2dh12_mode_set(&mode);
+  err_code |= ruuvi_interface_lis2dh12_fifo_interrupt_use(false);
+  err_code |= ruuvi_platform_gpio_interrupt_disable(governor.config.fifo_pin);
+  err_code |= governor_drain();
+  err_code |= ruuvi_interface_lis2dh12_fifo_use(false);
+  governor_deselect(previous);
+  governor.running = false;
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_governor_state_get(ruuvi_interface_lis2dh12_governor_state_t* const state)
+{
+  if(NULL == state) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(!governor.running) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  *state = governor.state;
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+#endif
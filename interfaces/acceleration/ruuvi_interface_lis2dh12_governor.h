@@ -0,0 +1,87 @@
+/**
+ * Power mode governor for LIS2DH12.
+ * Samples at idle profile, for example 8 bit resolution at low samplerate, until activity interrupt
+ * switches to active profile, for example 12 bit resolution at high samplerate. Returns to idle profile
+ * after a quiet period without activity. Samples are read from FIFO and given to application in blocks
+ * annotated with the profile they were taken in.
+ *
+ * License: BSD-3
+ * Author: Otso Jousimaa <otso@ojousima.net>
+ */
+
+#ifndef RUUVI_INTERFACE_LIS2DH12_GOVERNOR_H
+#define RUUVI_INTERFACE_LIS2DH12_GOVERNOR_H
+#include "ruuvi_driver_error.h"
+#include "ruuvi_interface_acceleration.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  RUUVI_INTERFACE_LIS2DH12_GOVERNOR_IDLE,
+  RUUVI_INTERFACE_LIS2DH12_GOVERNOR_ACTIVE
+}ruuvi_interface_lis2dh12_governor_state_t;
+
+/**
+ * Sensor settings of one state.
+ */
+typedef struct {
+  uint16_t samplerate_hz; ///< Samplerate, see ruuvi_interface_lis2dh12_samplerate_hz_set
+  uint8_t  resolution;    ///< Resolution in bits, 8, 10 or 12
+  uint8_t  scale;         ///< Scale in g, 2, 4, 8 or 16
+}ruuvi_interface_lis2dh12_governor_profile_t;
+
+/**
+ * Called with a block of raw samples read from FIFO.
+ * info describes the profile samples were taken in, state tells which profile it is.
+ */
+typedef void(*ruuvi_interface_lis2dh12_governor_cb_t)(const int16_t* const raw, const size_t count, const ruuvi_interface_acceleration_raw_info_t* const info, const ruuvi_interface_lis2dh12_governor_state_t state);
+
+typedef struct {
+  ruuvi_interface_lis2dh12_governor_profile_t idle;   ///< Profile while there is no activity
+  ruuvi_interface_lis2dh12_governor_profile_t active; ///< Profile after activity
+  float    activity_g;   ///< High-passed acceleration which switches to active profile
+  uint16_t activity_ms;  ///< Time acceleration must stay above activity threshold
+  uint32_t quiet_ms;     ///< Time without activity before returning to idle profile
+  uint8_t  fifo_pin;     ///< GPIO connected to LIS2DH12 INT1, FIFO watermark
+  uint8_t  activity_pin; ///< GPIO connected to LIS2DH12 INT2, activity
+  ruuvi_interface_lis2dh12_governor_cb_t callback; ///< Called with samples
+}ruuvi_interface_lis2dh12_governor_config_t;
+
+/**
+ * Start governing the selected LIS2DH12. Sensor is switched to idle profile in continuous mode with FIFO
+ * and watermark interrupt on INT1, and activity detection on INT2 by ruuvi_interface_lis2dh12_motion.
+ * FIFO is drained on every watermark interrupt and before every profile change, so no samples are lost
+ * in transitions. Transitions and drains run in scheduler context, interrupts and timers only schedule them.
+ * Scheduler, timers and GPIO interrupts must be initialized.
+ *
+ * parameter config: Governor configuration, copied by governor.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if config or callback is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_PARAM if samplerate of a profile is 0 or not available at its resolution
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if governor is running or sensor is not in sleep mode
+ * return: error code from stack on error.
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_governor_start(const ruuvi_interface_lis2dh12_governor_config_t* const config);
+
+/**
+ * Stop governing. Remaining FIFO contents are given to callback and sensor is left in sleep mode.
+ * Interrupt pins are released and can be used again.
+ *
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if governor is not running
+ * return: error code from stack on error.
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_governor_stop(void);
+
+/**
+ * Get current state of governor.
+ *
+ * parameter state: Output: current state.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if state is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if governor is not running
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_governor_state_get(ruuvi_interface_lis2dh12_governor_state_t* const state);
+
+#endif
@@ -0,0 +1,358 @@
+/**
+ * LIS2DH12 motion event detection.
+ * Programs interrupt generators, sleep-to-wake function and click engine of LIS2DH12
+ * and decodes their sources on INT2 interrupt.
+ * Requires STM lis2dh12 driver.
+ *
+ * License: BSD-3
+ * Author: Otso Jousimaa <otso@ojousima.net>
+ */
+
+#include "ruuvi_platform_external_includes.h"
+#if RUUVI_INTERFACE_ACCELERATION_LIS2DH12_ENABLED
+#include "ruuvi_driver_error.h"
+#include "ruuvi_driver_sensor.h"
+#include "ruuvi_interface_gpio.h"
+#include "ruuvi_interface_gpio_interrupt.h"
+#include "ruuvi_interface_lis2dh12.h"
+#include "ruuvi_interface_lis2dh12_motion.h"
+#include "ruuvi_interface_scheduler.h"
+
+#include "lis2dh12_reg.h"
+
+#include <string.h>
+
+// Latch bit of click source in CLICK_THS register
+#define LIS2DH12_CLICK_THS_LIR (1<<7)
+
+static struct {
+  lis2dh12_ctx_t* ctx;                           // Context of the sensor events are read from
+  ruuvi_interface_lis2dh12_motion_cb_t callback; // Called with decoded events
+  uint8_t events;                                // Enabled events
+  uint8_t pin;                                   // GPIO connected to INT2
+}motion = {0};
+
+/*
+ * Convert threshold in g to 7-bit register value, rounded up. Threshold is written back with value that was set.
+ * 1 LSb = 16 mg @ FS = 2 g
+ * 1 LSb = 32 mg @ FS = 4 g
+ * 1 LSb = 62 mg @ FS = 8 g
+ * 1 LSb = 186 mg @ FS = 16 g
+ */
+static ruuvi_driver_status_t motion_threshold(float* const threshold_g, const uint8_t scale, uint8_t* const lsb)
+{
+  float divisor;
+  switch(scale)
+  {
+    case 2:
+      divisor = 0.016f;
+      break;
+
+    case 4:
+      divisor = 0.032f;
+      break;
+
+    case 8:
+      divisor = 0.062f;
+      break;
+
+    case 16:
+      divisor = 0.186f;
+      break;
+
+    default:
+      return RUUVI_DRIVER_ERROR_INTERNAL;
+  }
+
+  uint32_t threshold = (uint32_t)(*threshold_g/divisor) + 1;
+  if(threshold > 0x7F) { return RUUVI_DRIVER_ERROR_INVALID_PARAM; }
+  *lsb = (uint8_t)threshold;
+  *threshold_g = threshold*divisor;
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+/*
+ * Convert duration in ms to samples at given samplerate, rounded up. Duration is written back with value that was set.
+ */
+static ruuvi_driver_status_t motion_duration(uint16_t* const duration_ms, const uint16_t samplerate, const uint8_t max, uint8_t* const lsb)
+{
+  uint32_t samples = (((uint32_t)*duration_ms * samplerate) + 999) / 1000;
+  if(samples > max) { return RUUVI_DRIVER_ERROR_INVALID_PARAM; }
+  *lsb = (uint8_t)samples;
+  *duration_ms = (uint16_t)((samples * 1000) / samplerate);
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+/*
+ * Convert inactivity duration in ms to Act_DUR, duration is (8 * Act_DUR + 1) / ODR. Rounded up.
+ */
+static ruuvi_driver_status_t motion_inactivity_duration(uint16_t* const duration_ms, const uint16_t samplerate, uint8_t* const lsb)
+{
+  uint32_t samples = (((uint32_t)*duration_ms * samplerate) + 999) / 1000;
+  uint32_t act_dur = (samples > 1) ? ((samples - 1) + 7) / 8 : 0;
+  if(act_dur > 0xFF) { return RUUVI_DRIVER_ERROR_INVALID_PARAM; }
+  *lsb = (uint8_t)act_dur;
+  *duration_ms = (uint16_t)((((8 * act_dur) + 1) * 1000) / samplerate);
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+// Read and decode event sources. Runs in scheduler context.
+static void motion_task(void* p_event_data, uint16_t event_size)
+{
+  if(NULL == motion.ctx) { return; }
+
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  ruuvi_interface_lis2dh12_motion_evt_t event = {0};
+  event.timestamp_ms = RUUVI_DRIVER_UINT64_INVALID;
+  if(NULL != p_event_data && sizeof(uint64_t) == event_size) { memcpy(&event.timestamp_ms, p_event_data, sizeof(uint64_t)); }
+
+  // Reading sources clears latched interrupts
+  if(RUUVI_INTERFACE_LIS2DH12_MOTION_ACTIVITY & motion.events)
+  {
+    lis2dh12_int1_src_t src;
+    err_code |= lis2dh12_int1_gen_source_get(motion.ctx, &src);
+    if(src.ia)
+    {
+      event.events |= RUUVI_INTERFACE_LIS2DH12_MOTION_ACTIVITY;
+      if(src.xh) { event.axes |= RUUVI_INTERFACE_LIS2DH12_MOTION_AXIS_X; }
+      if(src.yh) { event.axes |= RUUVI_INTERFACE_LIS2DH12_MOTION_AXIS_Y; }
+      if(src.zh) { event.axes |= RUUVI_INTERFACE_LIS2DH12_MOTION_AXIS_Z; }
+    }
+  }
+
+  if((RUUVI_INTERFACE_LIS2DH12_MOTION_FREEFALL | RUUVI_INTERFACE_LIS2DH12_MOTION_ORIENTATION) & motion.events)
+  {
+    lis2dh12_int2_src_t src;
+    err_code |= lis2dh12_int2_gen_source_get(motion.ctx, &src);
+    if(src.ia)
+    {
+      event.events |= motion.events & (RUUVI_INTERFACE_LIS2DH12_MOTION_FREEFALL | RUUVI_INTERFACE_LIS2DH12_MOTION_ORIENTATION);
+      event.orientation = (src.xl << 0) | (src.xh << 1) | (src.yl << 2) | (src.yh << 3) | (src.zl << 4) | (src.zh << 5);
+    }
+  }
+
+  if((RUUVI_INTERFACE_LIS2DH12_MOTION_SINGLE_CLICK | RUUVI_INTERFACE_LIS2DH12_MOTION_DOUBLE_CLICK) & motion.events)
+  {
+    lis2dh12_click_src_t src;
+    err_code |= lis2dh12_tap_source_get(motion.ctx, &src);
+    if(src.ia)
+    {
+      if(src.sclick) { event.events |= RUUVI_INTERFACE_LIS2DH12_MOTION_SINGLE_CLICK; }
+      if(src.dclick) { event.events |= RUUVI_INTERFACE_LIS2DH12_MOTION_DOUBLE_CLICK; }
+      if(src.x) { event.axes |= RUUVI_INTERFACE_LIS2DH12_MOTION_AXIS_X; }
+      if(src.y) { event.axes |= RUUVI_INTERFACE_LIS2DH12_MOTION_AXIS_Y; }
+      if(src.z) { event.axes |= RUUVI_INTERFACE_LIS2DH12_MOTION_AXIS_Z; }
+      event.click_negative = src.sign;
+    }
+  }
+
+  // Sleep-to-wake has no source register, interrupt without other source is inactivity.
+  if(0 == event.events && (RUUVI_INTERFACE_LIS2DH12_MOTION_INACTIVITY & motion.events))
+  {
+    event.events |= RUUVI_INTERFACE_LIS2DH12_MOTION_INACTIVITY;
+  }
+
+  RUUVI_DRIVER_ERROR_CHECK(err_code, ~RUUVI_DRIVER_ERROR_FATAL);
+  if(RUUVI_DRIVER_SUCCESS == err_code && 0 != event.events && NULL != motion.callback) { motion.callback(&event); }
+}
+
+// INT2 interrupt, timestamp event and defer the bus access to scheduler.
+static void motion_isr(const ruuvi_interface_gpio_evt_t event)
+{
+  if(NULL == motion.ctx) { return; }
+  uint64_t timestamp = ruuvi_driver_sensor_timestamp_get();
+  ruuvi_platform_scheduler_event_put(&timestamp, sizeof(timestamp), motion_task);
+}
+
+// Program generators, write back the values that were set.
+static ruuvi_driver_status_t motion_configure(lis2dh12_ctx_t* const ctx, ruuvi_interface_lis2dh12_motion_config_t* const config, uint8_t* const events)
+{
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  uint8_t scale;
+  uint16_t samplerate;
+  err_code |= ruuvi_interface_lis2dh12_scale_get(&scale);
+  err_code |= ruuvi_interface_lis2dh12_samplerate_hz_get(&samplerate);
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+
+  uint8_t threshold = 0;
+  uint8_t duration = 0;
+  lis2dh12_int1_cfg_t int1_cfg = { 0 };
+  lis2dh12_int2_cfg_t int2_cfg = { 0 };
+  lis2dh12_click_cfg_t click_cfg = { 0 };
+  *events = 0;
+
+  // Generator 1: OR of high events on high-passed data
+  if(0 < config->activity_g)
+  {
+    err_code |= motion_threshold(&(config->activity_g), scale, &threshold);
+    err_code |= motion_duration(&(config->activity_ms), samplerate, 0x7F, &duration);
+    if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+    int1_cfg.xhie = PROPERTY_ENABLE;
+    int1_cfg.yhie = PROPERTY_ENABLE;
+    int1_cfg.zhie = PROPERTY_ENABLE;
+    err_code |= lis2dh12_int1_gen_threshold_set(ctx, threshold);
+    err_code |= lis2dh12_int1_gen_duration_set(ctx, duration);
+    *events |= RUUVI_INTERFACE_LIS2DH12_MOTION_ACTIVITY;
+  }
+  err_code |= lis2dh12_int1_gen_conf_set(ctx, &int1_cfg);
+
+  // Generator 2: AND of low events for free-fall, 6D movement recognition for orientation
+  if(0 < config->freefall_g)
+  {
+    err_code |= motion_threshold(&(config->freefall_g), scale, &threshold);
+    err_code |= motion_duration(&(config->freefall_ms), samplerate, 0x7F, &duration);
+    if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+    int2_cfg.aoi  = PROPERTY_ENABLE;
+    int2_cfg.xlie = PROPERTY_ENABLE;
+    int2_cfg.ylie = PROPERTY_ENABLE;
+    int2_cfg.zlie = PROPERTY_ENABLE;
+    *events |= RUUVI_INTERFACE_LIS2DH12_MOTION_FREEFALL;
+  }
+  else if(0 < config->orientation_g)
+  {
+    err_code |= motion_threshold(&(config->orientation_g), scale, &threshold);
+    err_code |= motion_duration(&(config->orientation_ms), samplerate, 0x7F, &duration);
+    if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+    int2_cfg.aoi  = PROPERTY_ENABLE;
+    int2_cfg._6d  = PROPERTY_ENABLE;
+    int2_cfg.xlie = PROPERTY_ENABLE;
+    int2_cfg.xhie = PROPERTY_ENABLE;
+    int2_cfg.ylie = PROPERTY_ENABLE;
+    int2_cfg.yhie = PROPERTY_ENABLE;
+    int2_cfg.zlie = PROPERTY_ENABLE;
+    int2_cfg.zhie = PROPERTY_ENABLE;
+    *events |= RUUVI_INTERFACE_LIS2DH12_MOTION_ORIENTATION;
+  }
+  if((RUUVI_INTERFACE_LIS2DH12_MOTION_FREEFALL | RUUVI_INTERFACE_LIS2DH12_MOTION_ORIENTATION) & *events)
+  {
+    err_code |= lis2dh12_int2_gen_threshold_set(ctx, threshold);
+    err_code |= lis2dh12_int2_gen_duration_set(ctx, duration);
+  }
+  err_code |= lis2dh12_int2_gen_conf_set(ctx, &int2_cfg);
+
+  // Click engine, double click if latency is given
+  if(0 < config->click_g)
+  {
+    uint8_t limit, latency, window;
+    err_code |= motion_threshold(&(config->click_g), scale, &threshold);
+    err_code |= motion_duration(&(config->click_limit_ms), samplerate, 0x7F, &limit);
+    err_code |= motion_duration(&(config->click_latency_ms), samplerate, 0xFF, &latency);
+    err_code |= motion_duration(&(config->click_window_ms), samplerate, 0xFF, &window);
+    if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+    click_cfg.xs = PROPERTY_ENABLE;
+    click_cfg.ys = PROPERTY_ENABLE;
+    click_cfg.zs = PROPERTY_ENABLE;
+    *events |= RUUVI_INTERFACE_LIS2DH12_MOTION_SINGLE_CLICK;
+    if(0 < latency)
+    {
+      click_cfg.xd = PROPERTY_ENABLE;
+      click_cfg.yd = PROPERTY_ENABLE;
+      click_cfg.zd = PROPERTY_ENABLE;
+      *events |= RUUVI_INTERFACE_LIS2DH12_MOTION_DOUBLE_CLICK;
+    }
+    // Latch click source until read
+    threshold |= LIS2DH12_CLICK_THS_LIR;
+    err_code |= lis2dh12_write_reg(ctx, LIS2DH12_CLICK_THS, &threshold, 1);
+    err_code |= lis2dh12_shock_dur_set(ctx, limit);
+    err_code |= lis2dh12_quiet_dur_set(ctx, latency);
+    err_code |= lis2dh12_double_tap_timeout_set(ctx, window);
+  }
+  err_code |= lis2dh12_tap_conf_set(ctx, &click_cfg);
+
+  // Sleep-to-wake, threshold 0 would disable function.
+  threshold = 0;
+  duration = 0;
+  if(0 < config->inactivity_g)
+  {
+    err_code |= motion_threshold(&(config->inactivity_g), scale, &threshold);
+    err_code |= motion_inactivity_duration(&(config->inactivity_ms), samplerate, &duration);
+    if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+    *events |= RUUVI_INTERFACE_LIS2DH12_MOTION_INACTIVITY;
+  }
+  err_code |= lis2dh12_act_threshold_set(ctx, threshold);
+  err_code |= lis2dh12_act_timeout_set(ctx, duration);
+
+  // High-pass activity and click, free-fall and orientation use gravity.
+  lis2dh12_hp_t high_pass = LIS2DH12_DISC_FROM_INT_GENERATOR;
+  bool activity = RUUVI_INTERFACE_LIS2DH12_MOTION_ACTIVITY & *events;
+  bool click    = RUUVI_INTERFACE_LIS2DH12_MOTION_SINGLE_CLICK & *events;
+  if(activity && click) { high_pass = LIS2DH12_ON_INT1_TAP_GEN; }
+  else if(activity)     { high_pass = LIS2DH12_ON_INT1_GEN; }
+  else if(click)        { high_pass = LIS2DH12_ON_TAP_GEN; }
+  err_code |= lis2dh12_high_pass_int_conf_set(ctx, high_pass);
+
+  // Latch generator sources until read
+  err_code |= lis2dh12_int1_pin_notification_mode_set(ctx, LIS2DH12_INT1_LATCHED);
+  err_code |= lis2dh12_int2_pin_notification_mode_set(ctx, LIS2DH12_INT2_LATCHED);
+
+  // Route events to INT2, leave other INT2 sources as they are.
+  lis2dh12_ctrl_reg6_t ctrl6;
+  err_code |= lis2dh12_pin_int2_config_get(ctx, &ctrl6);
+  ctrl6.i2_ia1   = (RUUVI_INTERFACE_LIS2DH12_MOTION_ACTIVITY & *events) ? PROPERTY_ENABLE : PROPERTY_DISABLE;
+  ctrl6.i2_ia2   = ((RUUVI_INTERFACE_LIS2DH12_MOTION_FREEFALL | RUUVI_INTERFACE_LIS2DH12_MOTION_ORIENTATION) & *events) ? PROPERTY_ENABLE : PROPERTY_DISABLE;
+  ctrl6.i2_click = (RUUVI_INTERFACE_LIS2DH12_MOTION_SINGLE_CLICK & *events) ? PROPERTY_ENABLE : PROPERTY_DISABLE;
+  ctrl6.i2_act   = (RUUVI_INTERFACE_LIS2DH12_MOTION_INACTIVITY & *events) ? PROPERTY_ENABLE : PROPERTY_DISABLE;
+  err_code |= lis2dh12_pin_int2_config_set(ctx, &ctrl6);
+
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_motion_enable(const uint8_t pin, ruuvi_interface_lis2dh12_motion_config_t* const config, const ruuvi_interface_lis2dh12_motion_cb_t callback)
+{
+  if(NULL == config || NULL == callback) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(NULL != motion.ctx) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  if(0 < config->freefall_g && 0 < config->orientation_g) { return RUUVI_DRIVER_ERROR_INVALID_PARAM; }
+  lis2dh12_ctx_t* const ctx = ruuvi_interface_lis2dh12_ctx_get();
+  if(NULL == ctx) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  uint8_t mode;
+  ruuvi_interface_lis2dh12_mode_get(&mode);
+  if(RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS != mode) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+
+  // Interrupts are ignored until context is set. Pin may be in use by another module, leave it as it is.
+  ruuvi_driver_status_t err_code = ruuvi_platform_gpio_interrupt_enable(pin,
+                                                                        RUUVI_INTERFACE_GPIO_SLOPE_LOTOHI,
+                                                                        RUUVI_INTERFACE_GPIO_MODE_INPUT_NOPULL,
+                                                                        motion_isr);
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+
+  uint8_t events = 0;
+  err_code |= motion_configure(ctx, config, &events);
+  if(RUUVI_DRIVER_SUCCESS != err_code)
+  {
+    ruuvi_platform_gpio_interrupt_disable(pin);
+    return err_code;
+  }
+
+  motion.callback = callback;
+  motion.events = events;
+  motion.pin = pin;
+  motion.ctx = ctx;
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_motion_disable(void)
+{
+  if(NULL == motion.ctx) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  lis2dh12_ctx_t* const ctx = motion.ctx;
+  const uint8_t pin = motion.pin;
+  memset(&motion, 0, sizeof(motion));
+
+  ruuvi_driver_status_t err_code = ruuvi_platform_gpio_interrupt_disable(pin);
+  lis2dh12_int1_cfg_t int1_cfg = { 0 };
+  lis2dh12_int2_cfg_t int2_cfg = { 0 };
+  lis2dh12_click_cfg_t click_cfg = { 0 };
+  lis2dh12_ctrl_reg6_t ctrl6;
+  err_code |= lis2dh12_int1_gen_conf_set(ctx, &int1_cfg);
+  err_code |= lis2dh12_int2_gen_conf_set(ctx, &int2_cfg);
+  err_code |= lis2dh12_tap_conf_set(ctx, &click_cfg);
+  err_code |= lis2dh12_act_threshold_set(ctx, 0);
+  err_code |= lis2dh12_pin_int2_config_get(ctx, &ctrl6);
+  ctrl6.i2_ia1   = PROPERTY_DISABLE;
+  ctrl6.i2_ia2   = PROPERTY_DISABLE;
+  ctrl6.i2_click = PROPERTY_DISABLE;
+  ctrl6.i2_act   = PROPERTY_DISABLE;
+  err_code |= lis2dh12_pin_int2_config_set(ctx, &ctrl6);
+  return err_code;
+}
+
+#endif
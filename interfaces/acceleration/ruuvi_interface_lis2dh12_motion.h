@@ -0,0 +1,93 @@
+/**
+ * Motion event detection on LIS2DH12 interrupt generators and click engine.
+ * Events are detected by the sensor, MCU is woken up only by interrupt on INT2.
+ *
+ * License: BSD-3
+ * Author: Otso Jousimaa <otso@ojousima.net>
+ */
+
+#ifndef RUUVI_INTERFACE_LIS2DH12_MOTION_H
+#define RUUVI_INTERFACE_LIS2DH12_MOTION_H
+#include "ruuvi_driver_error.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Events, bits of ruuvi_interface_lis2dh12_motion_evt_t.events
+#define RUUVI_INTERFACE_LIS2DH12_MOTION_ACTIVITY     (1<<0) ///< Acceleration above activity threshold, high-passed
+#define RUUVI_INTERFACE_LIS2DH12_MOTION_INACTIVITY   (1<<1) ///< Acceleration below inactivity threshold for inactivity duration
+#define RUUVI_INTERFACE_LIS2DH12_MOTION_FREEFALL     (1<<2) ///< All axes below free-fall threshold
+#define RUUVI_INTERFACE_LIS2DH12_MOTION_ORIENTATION  (1<<3) ///< Sensor settled into new 6D orientation
+#define RUUVI_INTERFACE_LIS2DH12_MOTION_SINGLE_CLICK (1<<4) ///< Single click
+#define RUUVI_INTERFACE_LIS2DH12_MOTION_DOUBLE_CLICK (1<<5) ///< Double click
+
+// Axes, bits of ruuvi_interface_lis2dh12_motion_evt_t.axes
+#define RUUVI_INTERFACE_LIS2DH12_MOTION_AXIS_X (1<<0)
+#define RUUVI_INTERFACE_LIS2DH12_MOTION_AXIS_Y (1<<1)
+#define RUUVI_INTERFACE_LIS2DH12_MOTION_AXIS_Z (1<<2)
+
+/**
+ * Motion detection parameters. Threshold of 0 disables the event.
+ * Thresholds are in g and durations in milliseconds. Values are rounded up to
+ * register resolution at current scale and samplerate, and written back with the values that were set.
+ * Free-fall and orientation share a generator, only one of them can be enabled.
+ */
+typedef struct {
+  float    activity_g;        ///< Per-axis high-passed acceleration to trigger activity
+  uint16_t activity_ms;       ///< Time acceleration must stay above activity threshold
+  float    inactivity_g;      ///< Acceleration to stay below to trigger inactivity
+  uint16_t inactivity_ms;     ///< Time acceleration must stay below inactivity threshold
+  float    freefall_g;        ///< Acceleration all axes must stay below to trigger free-fall
+  uint16_t freefall_ms;       ///< Time acceleration must stay below free-fall threshold
+  float    orientation_g;     ///< Acceleration along axis to recognize orientation
+  uint16_t orientation_ms;    ///< Time orientation must be stable
+  float    click_g;           ///< High-passed acceleration to recognize a click
+  uint16_t click_limit_ms;    ///< Time acceleration must fall below click threshold after exceeding it
+  uint16_t click_latency_ms;  ///< Time after first click before second click can start, 0 for single click only
+  uint16_t click_window_ms;   ///< Time after latency during which second click must start
+}ruuvi_interface_lis2dh12_motion_config_t;
+
+/**
+ * Decoded motion event.
+ */
+typedef struct {
+  uint64_t timestamp_ms; ///< Time of interrupt
+  uint8_t events;        ///< RUUVI_INTERFACE_LIS2DH12_MOTION_ events
+  uint8_t axes;          ///< RUUVI_INTERFACE_LIS2DH12_MOTION_AXIS_ axes of activity or click
+  uint8_t orientation;   ///< 6D position, bits 0...5: X low, X high, Y low, Y high, Z low, Z high
+  bool    click_negative;///< Sign of click acceleration
+}ruuvi_interface_lis2dh12_motion_evt_t;
+
+typedef void(*ruuvi_interface_lis2dh12_motion_cb_t)(const ruuvi_interface_lis2dh12_motion_evt_t* const event);
+
+/**
+ * Program interrupt generators and click engine of the selected LIS2DH12 and route them to INT2.
+ * Activity uses generator 1, free-fall or orientation generator 2 and inactivity the sleep-to-wake function.
+ * INT2 is handled by scheduling source decoding with ruuvi_platform_scheduler_event_put,
+ * so scheduler and GPIO interrupts must be initialized.
+ * Sensor must be in continuous mode as durations depend on samplerate.
+ * Motion detection replaces ruuvi_interface_lis2dh12_activity_interrupt_use,
+ * disable motion detection before uninitializing sensor.
+ *
+ * parameter pin: GPIO connected to LIS2DH12 INT2
+ * parameter config: Input: Requested parameters. Output: Parameters that were set.
+ * parameter callback: Function to call with decoded events.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if config or callback is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if sensor is not initialized, not in continuous mode or motion detection is already enabled
+ * return: RUUVI_DRIVER_ERROR_INVALID_PARAM if free-fall and orientation are both enabled or parameter does not fit in register
+ * return: error code from stack on error.
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_motion_enable(const uint8_t pin, ruuvi_interface_lis2dh12_motion_config_t* const config, const ruuvi_interface_lis2dh12_motion_cb_t callback);
+
+/**
+ * Disable motion detection, clear generators and click engine and release INT2 pin,
+ * so motion detection can be enabled again.
+ *
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if motion detection is not enabled
+ * return: error code from stack on error.
+ */
+ruuvi_driver_status_t ruuvi_interface_lis2dh12_motion_disable(void);
+
+#endif
@@ -19,4 +19,12 @@ typedef struct
   float reserved1;
 }ruuvi_interface_adc_data_t;
 
+// Description of a batch of raw samples from continuous sampling
+typedef struct
+{
+  uint64_t timestamp_ms;  // Time of the last sample in batch
+  uint16_t samplerate_hz; // Samples are 1000 / samplerate_hz ms apart
+  float    v_per_lsb;     // V per LSB of raw value
+}ruuvi_interface_adc_raw_info_t;
+
 #endif
\ No newline at end of file
@@ -8,6 +8,9 @@
 #define RUUVI_INTERFACE_ADC_MCU_H
 #include "ruuvi_driver_error.h"
 #include "ruuvi_driver_sensor.h"
+#include "ruuvi_interface_adc.h"
+#include <stddef.h>
+#include <stdint.h>
 
 typedef enum {
   RUUVI_INTERFACE_ADC_AIN0,
@@ -21,6 +24,12 @@ typedef enum {
   RUUVI_INTERFACE_ADC_AINVDD
 }ruuvi_interface_adc_channel_t;
 
+/**
+ * Called with a full batch of raw samples in continuous sampling. Called in interrupt context.
+ * Batch buffer is filled again after callback returns, copy or process samples before returning.
+ */
+typedef void(*ruuvi_interface_adc_mcu_batch_cb_t)(const int16_t* const raw, const size_t count, const ruuvi_interface_adc_raw_info_t* const info);
+
 ruuvi_driver_status_t ruuvi_interface_adc_mcu_init(ruuvi_driver_sensor_t* adc_sensor, ruuvi_driver_bus_t, uint8_t handle);
 ruuvi_driver_status_t ruuvi_interface_adc_mcu_uninit(ruuvi_driver_sensor_t* adc_sensor, ruuvi_driver_bus_t, uint8_t handle);
 ruuvi_driver_status_t ruuvi_interface_adc_mcu_samplerate_set(uint8_t* samplerate);
@@ -35,4 +44,33 @@ ruuvi_driver_status_t ruuvi_interface_adc_mcu_mode_set(uint8_t*);
 ruuvi_driver_status_t ruuvi_interface_adc_mcu_mode_get(uint8_t*);
 ruuvi_driver_status_t ruuvi_interface_adc_mcu_data_get(void* data);
 
+/**
+ * Set buffers for continuous sampling. If samplerate is set to 1 ... 200 Hz, continuous mode samples
+ * at samplerate triggered by hardware timer through PPI, without CPU involvement per sample.
+ * Samples are converted into two buffers by EasyDMA in turns, full buffer is given to callback while the other one is filled.
+ * data_get returns latest sample of latest batch. With default samplerate, continuous mode samples on data_get.
+ *
+ * parameter buffer: storage of 2 * samples int16_t, must stay valid while ADC is in continuous mode.
+ * parameter samples: number of samples in one batch, 1 ... 32767
+ * parameter callback: called with each full batch
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if buffer or callback is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_LENGTH if samples is out of range
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if ADC is not in sleep
+ */
+ruuvi_driver_status_t ruuvi_interface_adc_mcu_batch_set(int16_t* const buffer, const size_t samples, const ruuvi_interface_adc_mcu_batch_cb_t callback);
+
+/**
+ * Apply whole configuration at once. Configuration is validated before ADC is touched,
+ * and ADC is reinitialized at most once if resolution or oversampling changes.
+ *
+ * parameter sensor: ADC sensor interface.
+ * parameter config: input: requested configuration. Output: applied configuration.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if sensor or config is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if ADC is not initialized
+ * return: RUUVI_DRIVER_ERROR_NOT_SUPPORTED or RUUVI_DRIVER_ERROR_INVALID_PARAM if configuration is invalid
+ */
+ruuvi_driver_status_t ruuvi_interface_adc_mcu_configuration_set(const ruuvi_driver_sensor_t* sensor, ruuvi_driver_sensor_configuration_t* config);
+
 #endif
\ No newline at end of file
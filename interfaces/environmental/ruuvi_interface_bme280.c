@@ -2,7 +2,8 @@
  * BME280 interface.
  * Requires Bosch BME280_driver, available under BSD-3 on GitHub.
  * Will only get compiled if RUUVI_INTERFACE_ENVIRONMENTAL_BME280_ENABLED is defined as true
- * Requires BME280_FLOAT_ENABLE defined in makefile.
+ * Uses floating point compensation if BME280_FLOAT_ENABLE is defined in makefile, integer compensation otherwise.
+ * Define BME280_64BIT_ENABLE with integer compensation for 0.01 Pa pressure resolution.
  *
  * License: BSD-3
  * Author: Otso Jousimaa <otso@ojousima.net>
@@ -15,8 +16,10 @@
 #include "ruuvi_driver_sensor.h"
 #include "ruuvi_interface_bme280.h"
 #include "ruuvi_interface_environmental.h"
+#include "ruuvi_interface_scheduler.h"
 #include "ruuvi_interface_spi.h"
 #include "ruuvi_interface_spi_bme280.h"
+#include "ruuvi_interface_timer.h"
 #include "ruuvi_interface_yield.h"
 
 #include <string.h>
@@ -25,8 +28,12 @@
 #include "bme280.h"
 #include "bme280_defs.h"
 #include "bme280_selftest.h"
-#ifndef BME280_FLOAT_ENABLE
-  #error "Please #define BME280_FLOAT_ENABLE in makefile CFLAGS"
+
+// Integer compensation returns pressure in Pa * 100 with 64-bit math and in Pa with 32-bit math.
+#if !defined(BME280_FLOAT_ENABLE) && defined(BME280_64BIT_ENABLE)
+  #define BME280_PRESSURE_TO_PA100(pressure) (pressure)
+#else
+  #define BME280_PRESSURE_TO_PA100(pressure) ((pressure) * 100)
 #endif
 
 // Macro for checking "ignored" parameters NO_CHANGE, MIN, MAX, DEFAULT
@@ -38,7 +45,8 @@
              ) return RUUVI_DRIVER_SUCCESS;\
            } while(0)
 
-// Macro for checking that sensor is in sleep mode before configuration
+// Macro for checking that sensor is in sleep mode before configuration.
+// Mode is read from shadow registers and does not cause bus traffic.
 #define VERIFY_SENSOR_SLEEPS() do { \
           uint8_t MACRO_MODE = 0; \
           ruuvi_interface_bme280_mode_get(&MACRO_MODE); \
@@ -46,10 +54,56 @@
           } while(0)
 
 
+// Status register, not defined by Bosch driver. BME280 datasheet 5.4.4.
+#define BME280_STATUS_ADDR      0xF3
+#define BME280_STATUS_MEASURING (1<<3)
+
+// Register bit fields, BME280 datasheet 5.4.
+#define BME280_CTRL_HUM_OSR_POS  0
+#define BME280_CTRL_MEAS_MODE_MSK 0x03
+#define BME280_CTRL_MEAS_OSR_P_POS 2
+#define BME280_CTRL_MEAS_OSR_T_POS 5
+#define BME280_CONFIG_FILTER_POS 2
+#define BME280_CONFIG_STANDBY_POS 5
+#define BME280_FIELD_MSK 0x07
+
 /** State variables **/
 static struct bme280_dev dev = {0};
 static uint64_t tsample;
 
+// RAM copy of configuration registers. Written on every configuration change and read back from
+// sensor only on init and ruuvi_interface_bme280_shadow_revalidate.
+static struct {
+  uint8_t ctrl_hum;  // 0xF2
+  uint8_t ctrl_meas; // 0xF4
+  uint8_t config;    // 0xF5
+}shadow = {0};
+
+// Normal mode streaming. Conversion n, starting from 1, is ready at
+// start_ms + (meas_us + (n - 1) * period_us) / 1000.
+static struct {
+  uint64_t start_ms;    // Time when normal mode was entered
+  uint32_t meas_us;     // Typical conversion time
+  uint32_t period_us;   // Conversion time + standby time
+  uint32_t settle;      // Conversions before IIR filter output has settled
+  uint32_t delivered;   // Number of latest delivered conversion
+  ruuvi_interface_environmental_data_t latest; // Latest delivered sample
+}stream = { .start_ms = RUUVI_DRIVER_UINT64_INVALID };
+
+// Calibration cache
+static ruuvi_interface_bme280_calibration_cache_t* p_calibration_cache = NULL;
+static size_t calibration_cache_entries = 0;
+// Compilation fails if Bosch calibration does not fit in cache entry
+typedef char bme280_calibration_fits_cache[(sizeof(struct bme280_calib_data) <= RUUVI_INTERFACE_BME280_CALIBRATION_WORDS * sizeof(uint32_t)) ? 1 : -1];
+
+// Asynchronous single measurement
+RUUVI_PLATFORM_TIMER_ID_DEF(bme280_single_timer);
+static bool single_timer_created = false;
+static struct {
+  ruuvi_interface_bme280_sample_cb_t callback; // Non-NULL while measurement is ongoing
+  uint8_t sequence;                            // Identifies measurement, stale scheduled readouts are ignored
+}async = {0};
+
 /**
  * Convert error from BME280 driver to appropriate NRF ERROR
  */
@@ -68,15 +122,240 @@ void bosch_delay_ms(uint32_t time_ms)
   ruuvi_platform_delay_ms(time_ms);
 }
 
-// BME280 datasheet Appendix B.
-static uint32_t bme280_max_meas_time(uint8_t oversampling)
+// Convert Bosch OSR setting to number of samples, 0 if channel is skipped.
+static uint8_t bme280_osr_to_samples(uint8_t osr)
 {
-  // Time
-  float time = 1.25f + \
-               2.3 * 3 * oversampling + \
-               2 * 0.575;
+  if(BME280_NO_OVERSAMPLING == osr) { return 0; }
+  if(BME280_OVERSAMPLING_16X < osr) { return 16; }
+  return 1 << (osr - 1);
+}
+
+// Maximum measurement time of enabled channels in dev.settings, BME280 datasheet Appendix B.
+static uint32_t bme280_max_meas_time(void)
+{
+  uint8_t samples_t = bme280_osr_to_samples(dev.settings.osr_t);
+  uint8_t samples_p = bme280_osr_to_samples(dev.settings.osr_p);
+  uint8_t samples_h = bme280_osr_to_samples(dev.settings.osr_h);
+  // Time in microseconds
+  uint32_t time = 1250 + 2300 * samples_t;
+  if(samples_p) { time += 2300 * samples_p + 575; }
+  if(samples_h) { time += 2300 * samples_h + 575; }
   // Roundoff + margin
-  return 2 + (uint32_t) time;
+  return 2 + time / 1000;
+}
+
+// Update dev.settings from shadow registers
+static void bme280_shadow_to_settings(void)
+{
+  dev.settings.osr_h        = (shadow.ctrl_hum  >> BME280_CTRL_HUM_OSR_POS)    & BME280_FIELD_MSK;
+  dev.settings.osr_p        = (shadow.ctrl_meas >> BME280_CTRL_MEAS_OSR_P_POS) & BME280_FIELD_MSK;
+  dev.settings.osr_t        = (shadow.ctrl_meas >> BME280_CTRL_MEAS_OSR_T_POS) & BME280_FIELD_MSK;
+  dev.settings.filter       = (shadow.config    >> BME280_CONFIG_FILTER_POS)   & BME280_FIELD_MSK;
+  dev.settings.standby_time = (shadow.config    >> BME280_CONFIG_STANDBY_POS)  & BME280_FIELD_MSK;
+}
+
+/**
+ * Write dev.settings to sensor and shadow registers in one burst.
+ * ctrl_hum takes effect only after ctrl_meas is written, so both are always written.
+ * Mode bits of ctrl_meas are kept as is, sensor must be in sleep while configured.
+ */
+static ruuvi_driver_status_t bme280_settings_write(void)
+{
+  uint8_t reg_addr[3] = { BME280_CTRL_HUM_ADDR, BME280_CTRL_MEAS_ADDR, BME280_CONFIG_ADDR };
+  uint8_t reg_data[3];
+  reg_data[0] = (shadow.ctrl_hum & ~(BME280_FIELD_MSK << BME280_CTRL_HUM_OSR_POS))
+                | ((dev.settings.osr_h & BME280_FIELD_MSK) << BME280_CTRL_HUM_OSR_POS);
+  reg_data[1] = (shadow.ctrl_meas & BME280_CTRL_MEAS_MODE_MSK)
+                | ((dev.settings.osr_p & BME280_FIELD_MSK) << BME280_CTRL_MEAS_OSR_P_POS)
+                | ((dev.settings.osr_t & BME280_FIELD_MSK) << BME280_CTRL_MEAS_OSR_T_POS);
+  reg_data[2] = (shadow.config & ~((BME280_FIELD_MSK << BME280_CONFIG_FILTER_POS) | (BME280_FIELD_MSK << BME280_CONFIG_STANDBY_POS)))
+                | ((dev.settings.filter & BME280_FIELD_MSK) << BME280_CONFIG_FILTER_POS)
+                | ((dev.settings.standby_time & BME280_FIELD_MSK) << BME280_CONFIG_STANDBY_POS);
+  ruuvi_driver_status_t err_code = BME_TO_RUUVI_ERROR(bme280_set_regs(reg_addr, reg_data, sizeof(reg_data), &dev));
+  if(RUUVI_DRIVER_SUCCESS == err_code)
+  {
+    shadow.ctrl_hum  = reg_data[0];
+    shadow.ctrl_meas = reg_data[1];
+    shadow.config    = reg_data[2];
+  }
+  // Keep dev.settings in sync with the sensor on error
+  bme280_shadow_to_settings();
+  return err_code;
+}
+
+// Write mode bits of ctrl_meas, other bits are taken from shadow.
+static ruuvi_driver_status_t bme280_mode_write(uint8_t bme_mode)
+{
+  uint8_t reg_addr = BME280_CTRL_MEAS_ADDR;
+  uint8_t reg_data = (shadow.ctrl_meas & ~BME280_CTRL_MEAS_MODE_MSK) | (bme_mode & BME280_CTRL_MEAS_MODE_MSK);
+  ruuvi_driver_status_t err_code = BME_TO_RUUVI_ERROR(bme280_set_regs(&reg_addr, &reg_data, 1, &dev));
+  if(RUUVI_DRIVER_SUCCESS == err_code) { shadow.ctrl_meas = reg_data; }
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_interface_bme280_shadow_revalidate(void)
+{
+  if(NULL == dev.write) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  // ctrl_hum, status, ctrl_meas and config are consecutive, read them in one transaction.
+  uint8_t regs[4];
+  ruuvi_driver_status_t err_code = BME_TO_RUUVI_ERROR(bme280_get_regs(BME280_CTRL_HUM_ADDR, regs, sizeof(regs), &dev));
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+  shadow.ctrl_hum  = regs[0];
+  shadow.ctrl_meas = regs[2];
+  shadow.config    = regs[3];
+  bme280_shadow_to_settings();
+  return err_code;
+}
+
+// FNV-1a over entry fields preceding check.
+static uint32_t bme280_calibration_cache_check(const ruuvi_interface_bme280_calibration_cache_t* const entry)
+{
+  const uint8_t* const bytes = (const uint8_t*)entry;
+  uint32_t hash = 2166136261U;
+  for(size_t ii = 0; ii < offsetof(ruuvi_interface_bme280_calibration_cache_t, check); ii++)
+  {
+    hash ^= bytes[ii];
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+static bool bme280_calibration_cache_valid(const ruuvi_interface_bme280_calibration_cache_t* const entry)
+{
+  return RUUVI_INTERFACE_BME280_CALIBRATION_CACHE_KEY == entry->key
+         && bme280_calibration_cache_check(entry) == entry->check;
+}
+
+// Return cached entry of sensor with given handle and chip ID, NULL if there is none.
+static const ruuvi_interface_bme280_calibration_cache_t* bme280_calibration_cached(const uint8_t handle, const uint8_t chip_id)
+{
+  for(size_t ii = 0; ii < calibration_cache_entries; ii++)
+  {
+    const ruuvi_interface_bme280_calibration_cache_t* const entry = &(p_calibration_cache[ii]);
+    if(bme280_calibration_cache_valid(entry)
+       && handle == entry->handle
+       && chip_id == entry->chip_id)
+    {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+// Store calibration of dev to first invalid or matching entry of cache
+static void bme280_calibration_cache_store(const uint8_t handle)
+{
+  ruuvi_interface_bme280_calibration_cache_t* free_entry = NULL;
+  for(size_t ii = 0; ii < calibration_cache_entries; ii++)
+  {
+    ruuvi_interface_bme280_calibration_cache_t* const entry = &(p_calibration_cache[ii]);
+    bool valid = bme280_calibration_cache_valid(entry);
+    if(valid && handle == entry->handle) { free_entry = entry; break; }
+    if(!valid && NULL == free_entry)     { free_entry = entry; }
+  }
+  if(NULL == free_entry) { return; }
+  // Clear padding so that check is reproducible
+  memset(free_entry, 0, sizeof(ruuvi_interface_bme280_calibration_cache_t));
+  free_entry->key = RUUVI_INTERFACE_BME280_CALIBRATION_CACHE_KEY;
+  free_entry->handle = handle;
+  free_entry->chip_id = dev.chip_id;
+  memcpy(free_entry->calibration, &(dev.calib_data), sizeof(dev.calib_data));
+  free_entry->check = bme280_calibration_cache_check(free_entry);
+}
+
+ruuvi_driver_status_t ruuvi_interface_bme280_calibration_cache_set(ruuvi_interface_bme280_calibration_cache_t* const cache, const size_t entries)
+{
+  if(NULL == cache && 0 != entries) { return RUUVI_DRIVER_ERROR_NULL; }
+  p_calibration_cache = cache;
+  calibration_cache_entries = (NULL == cache) ? 0 : entries;
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+/**
+ * Initialize Bosch driver. Calibration is taken from cache if there is a valid entry for the sensor,
+ * otherwise calibration is read and verified with CRC self-test and stored in cache.
+ */
+static ruuvi_driver_status_t bme280_calibration_init(const uint8_t handle)
+{
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  const ruuvi_interface_bme280_calibration_cache_t* entry = NULL;
+  if(0 < calibration_cache_entries)
+  {
+    uint8_t chip_id = 0;
+    err_code |= BME_TO_RUUVI_ERROR(bme280_get_regs(BME280_CHIP_ID_ADDR, &chip_id, 1, &dev));
+    if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+    if(BME280_CHIP_ID != chip_id) { return RUUVI_DRIVER_ERROR_NOT_FOUND; }
+    entry = bme280_calibration_cached(handle, chip_id);
+  }
+
+  if(NULL != entry)
+  {
+    dev.chip_id = entry->chip_id;
+    memcpy(&(dev.calib_data), entry->calibration, sizeof(dev.calib_data));
+    return err_code;
+  }
+
+  err_code |= BME_TO_RUUVI_ERROR(bme280_init(&dev));
+  if(err_code != RUUVI_DRIVER_SUCCESS) { return err_code; }
+  int8_t rslt = bme280_crc_selftest(&dev);
+  err_code |= BME_TO_RUUVI_ERROR(rslt);
+  if(BME280_OK == rslt) { bme280_calibration_cache_store(handle); }
+  return err_code;
+}
+
+// Typical measurement time of enabled channels in dev.settings in microseconds, BME280 datasheet Appendix B.
+static uint32_t bme280_typ_meas_time_us(void)
+{
+  uint8_t samples_p = bme280_osr_to_samples(dev.settings.osr_p);
+  uint8_t samples_h = bme280_osr_to_samples(dev.settings.osr_h);
+  uint32_t time = 1000 + 2000 * bme280_osr_to_samples(dev.settings.osr_t);
+  if(samples_p) { time += 2000 * samples_p + 500; }
+  if(samples_h) { time += 2000 * samples_h + 500; }
+  return time;
+}
+
+// Standby time between normal mode conversions in microseconds, BME280 datasheet 3.3.4.
+static uint32_t bme280_standby_time_us(void)
+{
+  switch(dev.settings.standby_time)
+  {
+    case BME280_STANDBY_TIME_1_MS:    return 500;
+    case BME280_STANDBY_TIME_62_5_MS: return 62500;
+    case BME280_STANDBY_TIME_125_MS:  return 125000;
+    case BME280_STANDBY_TIME_250_MS:  return 250000;
+    case BME280_STANDBY_TIME_500_MS:  return 500000;
+    case BME280_STANDBY_TIME_1000_MS: return 1000000;
+    case BME280_STANDBY_TIME_10_MS:   return 10000;
+    case BME280_STANDBY_TIME_20_MS:   return 20000;
+    default:                          return 0;
+  }
+}
+
+// Number of samples to reach 75 % of step response, BME280 datasheet 3.4.4.
+static uint32_t bme280_iir_settle_samples(void)
+{
+  switch(dev.settings.filter)
+  {
+    case BME280_FILTER_COEFF_2:  return 2;
+    case BME280_FILTER_COEFF_4:  return 5;
+    case BME280_FILTER_COEFF_8:  return 11;
+    case BME280_FILTER_COEFF_16: return 22;
+    default:                     return 1;
+  }
+}
+
+// Start tracking normal mode conversions
+static void bme280_stream_start(void)
+{
+  stream.start_ms  = ruuvi_driver_sensor_timestamp_get();
+  stream.meas_us   = bme280_typ_meas_time_us();
+  stream.period_us = stream.meas_us + bme280_standby_time_us();
+  stream.settle    = bme280_iir_settle_samples();
+  stream.delivered = 0;
+  stream.latest.timestamp_ms  = RUUVI_DRIVER_UINT64_INVALID;
+  stream.latest.temperature_c = RUUVI_INTERFACE_ENVIRONMENTAL_INVALID;
+  stream.latest.humidity_rh   = RUUVI_INTERFACE_ENVIRONMENTAL_INVALID;
+  stream.latest.pressure_pa   = RUUVI_INTERFACE_ENVIRONMENTAL_INVALID;
 }
 
 /** Initialize BME280 into low-power mode **/
@@ -98,10 +377,12 @@ ruuvi_driver_status_t ruuvi_interface_bme280_init(ruuvi_driver_sensor_t* environ
       dev.write = ruuvi_interface_spi_bme280_write;
       dev.delay_ms = bosch_delay_ms;
 
-      err_code |= BME_TO_RUUVI_ERROR(bme280_init(&dev));
+      err_code |= bme280_calibration_init(handle);
       if(err_code != RUUVI_DRIVER_SUCCESS) { return err_code; }
-      err_code |= BME_TO_RUUVI_ERROR(bme280_crc_selftest(&dev));
       err_code |= BME_TO_RUUVI_ERROR(bme280_soft_reset(&dev));
+      // Configuration registers are 0x00 after reset, BME280 datasheet 5.3.
+      memset(&shadow, 0, sizeof(shadow));
+      bme280_shadow_to_settings();
 
       // Setup Oversampling 1 to enable sensor
       uint8_t dsp = RUUVI_DRIVER_SENSOR_DSP_OS;
@@ -132,7 +413,7 @@ ruuvi_driver_status_t ruuvi_interface_bme280_init(ruuvi_driver_sensor_t* environ
     environmental_sensor->mode_set          = ruuvi_interface_bme280_mode_set;
     environmental_sensor->mode_get          = ruuvi_interface_bme280_mode_get;
     environmental_sensor->data_get          = ruuvi_interface_bme280_data_get;
-    environmental_sensor->configuration_set = ruuvi_driver_sensor_configuration_set;
+    environmental_sensor->configuration_set = ruuvi_interface_bme280_configuration_set;
     environmental_sensor->configuration_get = ruuvi_driver_sensor_configuration_get;
     tsample = RUUVI_DRIVER_UINT64_INVALID;
   }
@@ -146,32 +427,42 @@ ruuvi_driver_status_t ruuvi_interface_bme280_uninit(ruuvi_driver_sensor_t* senso
   if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
   memset(sensor, 0, sizeof(ruuvi_driver_sensor_t));
   memset(&dev, 0, sizeof(dev));
+  memset(&shadow, 0, sizeof(shadow));
   tsample = RUUVI_DRIVER_UINT64_INVALID;
   return err_code;
 }
 
-ruuvi_driver_status_t ruuvi_interface_bme280_samplerate_set(uint8_t* samplerate)
+// Convert samplerate to standby time of settings
+static ruuvi_driver_status_t bme280_samplerate_to_settings(uint8_t* const samplerate, struct bme280_settings* const settings)
 {
-  if(NULL == samplerate) { return RUUVI_DRIVER_ERROR_NULL; }
-  VERIFY_SENSOR_SLEEPS();
   ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
-  if(RUUVI_DRIVER_SENSOR_CFG_DEFAULT == *samplerate ) { dev.settings.standby_time = BME280_STANDBY_TIME_1000_MS; }
-  else if(*samplerate == 1)                           { dev.settings.standby_time = BME280_STANDBY_TIME_1000_MS; }
-  else if(*samplerate == 2)                           { dev.settings.standby_time = BME280_STANDBY_TIME_500_MS; }
-  else if(*samplerate <= 8)                           { dev.settings.standby_time = BME280_STANDBY_TIME_125_MS; }
-  else if(*samplerate <= 16)                          { dev.settings.standby_time = BME280_STANDBY_TIME_62_5_MS; }
-  else if(*samplerate <= 50)                          { dev.settings.standby_time = BME280_STANDBY_TIME_20_MS; }
-  else if(*samplerate <= 100)                         { dev.settings.standby_time = BME280_STANDBY_TIME_10_MS; }
-  else if(*samplerate <= 200)                         { dev.settings.standby_time = BME280_STANDBY_TIME_1_MS; }
-  else if(RUUVI_DRIVER_SENSOR_CFG_MIN == *samplerate) { dev.settings.standby_time = BME280_STANDBY_TIME_1000_MS; }
-  else if(RUUVI_DRIVER_SENSOR_CFG_MAX == *samplerate) { dev.settings.standby_time = BME280_STANDBY_TIME_1_MS; }
+  if(RUUVI_DRIVER_SENSOR_CFG_DEFAULT == *samplerate ) { settings->standby_time = BME280_STANDBY_TIME_1000_MS; }
+  else if(*samplerate == 1)                           { settings->standby_time = BME280_STANDBY_TIME_1000_MS; }
+  else if(*samplerate == 2)                           { settings->standby_time = BME280_STANDBY_TIME_500_MS; }
+  else if(*samplerate <= 8)                           { settings->standby_time = BME280_STANDBY_TIME_125_MS; }
+  else if(*samplerate <= 16)                          { settings->standby_time = BME280_STANDBY_TIME_62_5_MS; }
+  else if(*samplerate <= 50)                          { settings->standby_time = BME280_STANDBY_TIME_20_MS; }
+  else if(*samplerate <= 100)                         { settings->standby_time = BME280_STANDBY_TIME_10_MS; }
+  else if(*samplerate <= 200)                         { settings->standby_time = BME280_STANDBY_TIME_1_MS; }
+  else if(RUUVI_DRIVER_SENSOR_CFG_MIN == *samplerate) { settings->standby_time = BME280_STANDBY_TIME_1000_MS; }
+  else if(RUUVI_DRIVER_SENSOR_CFG_MAX == *samplerate) { settings->standby_time = BME280_STANDBY_TIME_1_MS; }
   else if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == *samplerate) {} // do nothing
   else { *samplerate = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED; err_code |= RUUVI_DRIVER_ERROR_NOT_SUPPORTED; }
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_interface_bme280_samplerate_set(uint8_t* samplerate)
+{
+  if(NULL == samplerate) { return RUUVI_DRIVER_ERROR_NULL; }
+  VERIFY_SENSOR_SLEEPS();
+  struct bme280_settings settings = dev.settings;
+  ruuvi_driver_status_t err_code = bme280_samplerate_to_settings(samplerate, &settings);
 
   if(RUUVI_DRIVER_SUCCESS == err_code)
   {
   // BME 280 must be in standby while configured
-  err_code |=  BME_TO_RUUVI_ERROR(bme280_set_sensor_settings(BME280_STANDBY_SEL, &dev));
+  dev.settings = settings;
+  err_code |= bme280_settings_write();
   err_code |= ruuvi_interface_bme280_samplerate_get(samplerate);
   }
 
@@ -181,8 +472,7 @@ ruuvi_driver_status_t ruuvi_interface_bme280_samplerate_set(uint8_t* samplerate)
 ruuvi_driver_status_t ruuvi_interface_bme280_samplerate_get(uint8_t* samplerate)
 {
   if(NULL == samplerate) { return RUUVI_DRIVER_ERROR_NULL; }
-  ruuvi_driver_status_t err_code = BME_TO_RUUVI_ERROR(bme280_get_sensor_settings(&dev));
-  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
 
   if(BME280_STANDBY_TIME_1000_MS == dev.settings.standby_time)      { *samplerate = 1;   }
   else if(BME280_STANDBY_TIME_500_MS == dev.settings.standby_time)  { *samplerate = 2;   }
@@ -229,10 +519,9 @@ ruuvi_driver_status_t ruuvi_interface_bme280_scale_get(uint8_t* scale)
   return RUUVI_DRIVER_SUCCESS;
 }
 
-ruuvi_driver_status_t ruuvi_interface_bme280_dsp_set(uint8_t* dsp, uint8_t* parameter)
+// Convert DSP function and parameter to oversampling and filter of settings
+static ruuvi_driver_status_t bme280_dsp_to_settings(uint8_t* const dsp, uint8_t* const parameter, struct bme280_settings* const settings)
 {
-  if(NULL == dsp || NULL == parameter) { return RUUVI_DRIVER_ERROR_NULL; }
-  VERIFY_SENSOR_SLEEPS();
   // Validate configuration
   if(   1  != *parameter
      && 2  != *parameter
@@ -255,16 +544,11 @@ ruuvi_driver_status_t ruuvi_interface_bme280_dsp_set(uint8_t* dsp, uint8_t* para
   }
 
   // Clear setup
-  uint8_t settings_sel = 0;
   // Always 1x oversampling to keep sensing element enabled
-  dev.settings.osr_h = BME280_OVERSAMPLING_1X;
-  dev.settings.osr_p = BME280_OVERSAMPLING_1X;
-  dev.settings.osr_t = BME280_OVERSAMPLING_1X;
-  dev.settings.filter = BME280_FILTER_COEFF_OFF;
-  settings_sel |= BME280_OSR_PRESS_SEL;
-  settings_sel |= BME280_OSR_TEMP_SEL;
-  settings_sel |= BME280_OSR_HUM_SEL;
-  settings_sel |= BME280_FILTER_SEL;
+  settings->osr_h = BME280_OVERSAMPLING_1X;
+  settings->osr_p = BME280_OVERSAMPLING_1X;
+  settings->osr_t = BME280_OVERSAMPLING_1X;
+  settings->filter = BME280_FILTER_COEFF_OFF;
 
   // Setup IIR
   if(RUUVI_DRIVER_SENSOR_DSP_IIR & *dsp)
@@ -274,28 +558,28 @@ ruuvi_driver_status_t ruuvi_interface_bme280_dsp_set(uint8_t* dsp, uint8_t* para
        1 == *parameter
     )
     {
-      dev.settings.filter = BME280_FILTER_COEFF_OFF;
+      settings->filter = BME280_FILTER_COEFF_OFF;
       *parameter = 1;
     }
     else if(2 == *parameter)
     {
-      dev.settings.filter = BME280_FILTER_COEFF_2;
+      settings->filter = BME280_FILTER_COEFF_2;
       *parameter = 2;
     }
     else if(4 >= *parameter)
     {
-        dev.settings.filter = BME280_FILTER_COEFF_4;
+        settings->filter = BME280_FILTER_COEFF_4;
         *parameter = 4;
     }
     else if(8 >= *parameter)
     {
-      dev.settings.filter = BME280_FILTER_COEFF_8;
+      settings->filter = BME280_FILTER_COEFF_8;
       *parameter = 8;
     }
     else if(RUUVI_DRIVER_SENSOR_CFG_MAX == *parameter || \
             16 >= *parameter)
     {
-      dev.settings.filter = BME280_FILTER_COEFF_16;
+      settings->filter = BME280_FILTER_COEFF_16;
       *parameter = 16;
     }
     else
@@ -311,38 +595,38 @@ ruuvi_driver_status_t ruuvi_interface_bme280_dsp_set(uint8_t* dsp, uint8_t* para
        RUUVI_DRIVER_SENSOR_CFG_MIN     == *parameter || \
        1 == *parameter)
     {
-      dev.settings.osr_h = BME280_OVERSAMPLING_1X;
-      dev.settings.osr_p = BME280_OVERSAMPLING_1X;
-      dev.settings.osr_t = BME280_OVERSAMPLING_1X;
+      settings->osr_h = BME280_OVERSAMPLING_1X;
+      settings->osr_p = BME280_OVERSAMPLING_1X;
+      settings->osr_t = BME280_OVERSAMPLING_1X;
       *parameter = 1;
     }
     else if(2 == *parameter)
     {
-      dev.settings.osr_h = BME280_OVERSAMPLING_2X;
-      dev.settings.osr_p = BME280_OVERSAMPLING_2X;
-      dev.settings.osr_t = BME280_OVERSAMPLING_2X;
+      settings->osr_h = BME280_OVERSAMPLING_2X;
+      settings->osr_p = BME280_OVERSAMPLING_2X;
+      settings->osr_t = BME280_OVERSAMPLING_2X;
       *parameter = 2;
     }
     else if (4 >= *parameter)
     {
-      dev.settings.osr_h = BME280_OVERSAMPLING_4X;
-      dev.settings.osr_p = BME280_OVERSAMPLING_4X;
-      dev.settings.osr_t = BME280_OVERSAMPLING_4X;
+      settings->osr_h = BME280_OVERSAMPLING_4X;
+      settings->osr_p = BME280_OVERSAMPLING_4X;
+      settings->osr_t = BME280_OVERSAMPLING_4X;
       *parameter = 4;
     }
     else if (8 >= *parameter)
     {
-      dev.settings.osr_h = BME280_OVERSAMPLING_8X;
-      dev.settings.osr_p = BME280_OVERSAMPLING_8X;
-      dev.settings.osr_t = BME280_OVERSAMPLING_8X;
+      settings->osr_h = BME280_OVERSAMPLING_8X;
+      settings->osr_p = BME280_OVERSAMPLING_8X;
+      settings->osr_t = BME280_OVERSAMPLING_8X;
       *parameter = 8;
     }
     else if (16 >= *parameter || \
              RUUVI_DRIVER_SENSOR_CFG_MAX)
     {
-      dev.settings.osr_h = BME280_OVERSAMPLING_16X;
-      dev.settings.osr_p = BME280_OVERSAMPLING_16X;
-      dev.settings.osr_t = BME280_OVERSAMPLING_16X;
+      settings->osr_h = BME280_OVERSAMPLING_16X;
+      settings->osr_p = BME280_OVERSAMPLING_16X;
+      settings->osr_t = BME280_OVERSAMPLING_16X;
       *parameter = 16;
     }
     else
@@ -351,8 +635,20 @@ ruuvi_driver_status_t ruuvi_interface_bme280_dsp_set(uint8_t* dsp, uint8_t* para
       return RUUVI_DRIVER_ERROR_NOT_SUPPORTED;
     }
   }
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+ruuvi_driver_status_t ruuvi_interface_bme280_dsp_set(uint8_t* dsp, uint8_t* parameter)
+{
+  if(NULL == dsp || NULL == parameter) { return RUUVI_DRIVER_ERROR_NULL; }
+  VERIFY_SENSOR_SLEEPS();
+  struct bme280_settings settings = dev.settings;
+  ruuvi_driver_status_t err_code = bme280_dsp_to_settings(dsp, parameter, &settings);
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+
   //Write configuration
-  return BME_TO_RUUVI_ERROR(bme280_set_sensor_settings(settings_sel, &dev));
+  dev.settings = settings;
+  return bme280_settings_write();
 }
 
 // Read configuration
@@ -360,10 +656,6 @@ ruuvi_driver_status_t ruuvi_interface_bme280_dsp_get(uint8_t* dsp, uint8_t* para
 {
   if(NULL == dsp || NULL == parameter){ return RUUVI_DRIVER_ERROR_NULL; }
 
-  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
-  err_code |= BME_TO_RUUVI_ERROR(bme280_get_sensor_settings(&dev));
-  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
-
   // Assume default / 0,
   *dsp       = RUUVI_DRIVER_SENSOR_CFG_DEFAULT;
   *parameter = RUUVI_DRIVER_SENSOR_CFG_DEFAULT;
@@ -393,11 +685,15 @@ ruuvi_driver_status_t ruuvi_interface_bme280_dsp_get(uint8_t* dsp, uint8_t* para
   }
   // Check if OS has been set. If yes, read DSP param from there.
   // Param should be same for OS and IIR if it is >1.
-  // OSR is same for every element.
-  if(BME280_NO_OVERSAMPLING != dev.settings.osr_h && BME280_OVERSAMPLING_1X != dev.settings.osr_h)
+  // OSR is same for every element unless set with ruuvi_interface_bme280_oversampling_set,
+  // report highest OSR in that case.
+  uint8_t osr = dev.settings.osr_t;
+  if(osr < dev.settings.osr_p) { osr = dev.settings.osr_p; }
+  if(osr < dev.settings.osr_h) { osr = dev.settings.osr_h; }
+  if(BME280_NO_OVERSAMPLING != osr && BME280_OVERSAMPLING_1X != osr)
   {
     *dsp |= RUUVI_DRIVER_SENSOR_DSP_OS;
-    switch(dev.settings.osr_h)
+    switch(osr)
     {
       case BME280_OVERSAMPLING_2X:
         *parameter = 2;
@@ -420,6 +716,71 @@ ruuvi_driver_status_t ruuvi_interface_bme280_dsp_get(uint8_t* dsp, uint8_t* para
   return RUUVI_DRIVER_SUCCESS;
 }
 
+// Convert Bosch OSR setting to oversampling of a channel, skipped channel is reported as such.
+static uint8_t bme280_osr_to_oversampling(const uint8_t osr)
+{
+  if(BME280_NO_OVERSAMPLING == osr) { return RUUVI_INTERFACE_BME280_OVERSAMPLING_SKIP; }
+  return bme280_osr_to_samples(osr);
+}
+
+// Convert number of samples to Bosch OSR setting, rounding up. Returns false if samples is not supported.
+static bool bme280_samples_to_osr(uint8_t* const samples, uint8_t* const osr)
+{
+  if(RUUVI_INTERFACE_BME280_OVERSAMPLING_SKIP == *samples) { *osr = BME280_NO_OVERSAMPLING; }
+  else if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == *samples) { *samples = bme280_osr_to_oversampling(*osr); }
+  else if(RUUVI_DRIVER_SENSOR_CFG_DEFAULT == *samples
+          || RUUVI_DRIVER_SENSOR_CFG_MIN  == *samples) { *osr = BME280_OVERSAMPLING_1X; *samples = 1; }
+  else if(RUUVI_DRIVER_SENSOR_CFG_MAX     == *samples) { *osr = BME280_OVERSAMPLING_16X; *samples = 16; }
+  else if(1  == *samples) { *osr = BME280_OVERSAMPLING_1X; }
+  else if(2  == *samples) { *osr = BME280_OVERSAMPLING_2X; }
+  else if(4  >= *samples) { *osr = BME280_OVERSAMPLING_4X;  *samples = 4; }
+  else if(8  >= *samples) { *osr = BME280_OVERSAMPLING_8X;  *samples = 8; }
+  else if(16 >= *samples) { *osr = BME280_OVERSAMPLING_16X; *samples = 16; }
+  else { *samples = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED; return false; }
+  return true;
+}
+
+ruuvi_driver_status_t ruuvi_interface_bme280_oversampling_set(ruuvi_interface_bme280_oversampling_t* const oversampling)
+{
+  if(NULL == oversampling) { return RUUVI_DRIVER_ERROR_NULL; }
+  VERIFY_SENSOR_SLEEPS();
+  // Pressure and humidity compensation depend on temperature, temperature can't be skipped.
+  if(RUUVI_INTERFACE_BME280_OVERSAMPLING_SKIP == oversampling->temperature)
+  {
+    oversampling->temperature = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED;
+    return RUUVI_DRIVER_ERROR_NOT_SUPPORTED;
+  }
+
+  // Validate all before applying
+  uint8_t osr_t = dev.settings.osr_t;
+  uint8_t osr_p = dev.settings.osr_p;
+  uint8_t osr_h = dev.settings.osr_h;
+  bool valid = true;
+  valid &= bme280_samples_to_osr(&(oversampling->temperature), &osr_t);
+  valid &= bme280_samples_to_osr(&(oversampling->pressure), &osr_p);
+  valid &= bme280_samples_to_osr(&(oversampling->humidity), &osr_h);
+  if(!valid) { return RUUVI_DRIVER_ERROR_NOT_SUPPORTED; }
+
+  dev.settings.osr_t = osr_t;
+  dev.settings.osr_p = osr_p;
+  dev.settings.osr_h = osr_h;
+  return bme280_settings_write();
+}
+
+ruuvi_driver_status_t ruuvi_interface_bme280_oversampling_get(ruuvi_interface_bme280_oversampling_t* const oversampling)
+{
+  if(NULL == oversampling) { return RUUVI_DRIVER_ERROR_NULL; }
+  oversampling->temperature = bme280_osr_to_oversampling(dev.settings.osr_t);
+  oversampling->pressure    = bme280_osr_to_oversampling(dev.settings.osr_p);
+  oversampling->humidity    = bme280_osr_to_oversampling(dev.settings.osr_h);
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+uint32_t ruuvi_interface_bme280_measurement_time_get(void)
+{
+  return bme280_max_meas_time();
+}
+
 ruuvi_driver_status_t ruuvi_interface_bme280_mode_set(uint8_t* mode)
 {
   if(NULL == mode) { return RUUVI_DRIVER_ERROR_NULL; }
@@ -428,10 +789,17 @@ ruuvi_driver_status_t ruuvi_interface_bme280_mode_set(uint8_t* mode)
   switch(*mode)
   {
     case RUUVI_DRIVER_SENSOR_CFG_SLEEP:
-      err_code = BME_TO_RUUVI_ERROR(bme280_set_sensor_mode(BME280_SLEEP_MODE, &dev));
+      // Abort ongoing asynchronous measurement
+      if(NULL != async.callback)
+      {
+        err_code |= ruuvi_platform_timer_stop(bme280_single_timer);
+        async.callback = NULL;
+      }
+      err_code |= bme280_mode_write(BME280_SLEEP_MODE);
       break;
 
     case RUUVI_DRIVER_SENSOR_CFG_SINGLE:
+      if(NULL != async.callback) { return RUUVI_DRIVER_ERROR_BUSY; }
       // Do nothing if sensor is in continuous mode
       ruuvi_interface_bme280_mode_get(&current_mode);
       if(RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS == current_mode)
@@ -439,19 +807,21 @@ ruuvi_driver_status_t ruuvi_interface_bme280_mode_set(uint8_t* mode)
         *mode = RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS;
         return RUUVI_DRIVER_ERROR_INVALID_STATE;
       }
-      err_code = BME_TO_RUUVI_ERROR(bme280_set_sensor_mode(BME280_FORCED_MODE, &dev));
+      err_code = bme280_mode_write(BME280_FORCED_MODE);
+      if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
       // We assume that dev struct is in sync with the state of the BME280 and underlying interface
       // which has the number of settings as 2^OSR is not changed.
-      // We also assume that each element runs same OSR
-      uint8_t samples = 1 << (dev.settings.osr_h - 1);
-      ruuvi_platform_delay_ms(bme280_max_meas_time(samples));
+      ruuvi_platform_delay_ms(bme280_max_meas_time());
       tsample = ruuvi_driver_sensor_timestamp_get();
       // BME280 returns to SLEEP after forced sample
+      shadow.ctrl_meas &= ~BME280_CTRL_MEAS_MODE_MSK;
       *mode = RUUVI_DRIVER_SENSOR_CFG_SLEEP;
       break;
 
     case RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS:
-      err_code = BME_TO_RUUVI_ERROR(bme280_set_sensor_mode(BME280_NORMAL_MODE, &dev));
+      if(NULL != async.callback) { return RUUVI_DRIVER_ERROR_BUSY; }
+      err_code = bme280_mode_write(BME280_NORMAL_MODE);
+      if(RUUVI_DRIVER_SUCCESS == err_code) { bme280_stream_start(); }
       break;
 
     default:
@@ -465,16 +835,16 @@ ruuvi_driver_status_t ruuvi_interface_bme280_mode_get(uint8_t* mode)
 {
   if(NULL == mode) { return RUUVI_DRIVER_ERROR_NULL; }
   ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
-  uint8_t bme_mode = 0;
-  err_code = BME_TO_RUUVI_ERROR(bme280_get_sensor_mode(&bme_mode, &dev));
-  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+  uint8_t bme_mode = shadow.ctrl_meas & BME280_CTRL_MEAS_MODE_MSK;
 
   switch(bme_mode)
   {
     case BME280_SLEEP_MODE:
       *mode = RUUVI_DRIVER_SENSOR_CFG_SLEEP;
       break;
+    // Both 01 and 10 are forced mode
     case BME280_FORCED_MODE:
+    case (BME280_FORCED_MODE << 1):
       *mode = RUUVI_DRIVER_SENSOR_CFG_SINGLE;
       break;
     case BME280_NORMAL_MODE:
@@ -488,39 +858,258 @@ ruuvi_driver_status_t ruuvi_interface_bme280_mode_get(uint8_t* mode)
 }
 
 
+// True if parameter is one of "ignored" parameters NO_CHANGE, MIN, MAX, DEFAULT
+static bool bme280_is_ignored(const uint8_t parameter)
+{
+  return RUUVI_DRIVER_SENSOR_CFG_DEFAULT   == parameter
+         || RUUVI_DRIVER_SENSOR_CFG_MIN       == parameter
+         || RUUVI_DRIVER_SENSOR_CFG_MAX       == parameter
+         || RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == parameter;
+}
+
+ruuvi_driver_status_t ruuvi_interface_bme280_configuration_set(const ruuvi_driver_sensor_t* sensor, ruuvi_driver_sensor_configuration_t* config)
+{
+  if(NULL == sensor || NULL == config) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(NULL == dev.write) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  if(NULL != async.callback) { return RUUVI_DRIVER_ERROR_BUSY; }
+
+  // Validate whole configuration in RAM before touching the sensor
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  struct bme280_settings settings = dev.settings;
+  err_code |= bme280_samplerate_to_settings(&(config->samplerate), &settings);
+  if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE != config->dsp_function)
+  {
+    err_code |= bme280_dsp_to_settings(&(config->dsp_function), &(config->dsp_parameter), &settings);
+  }
+  if(!bme280_is_ignored(config->resolution)) { err_code |= RUUVI_DRIVER_ERROR_NOT_SUPPORTED; }
+  if(!bme280_is_ignored(config->scale))      { err_code |= RUUVI_DRIVER_ERROR_NOT_SUPPORTED; }
+  config->resolution = RUUVI_DRIVER_SENSOR_CFG_DEFAULT;
+  config->scale      = RUUVI_DRIVER_SENSOR_CFG_DEFAULT;
+  if(RUUVI_DRIVER_SENSOR_CFG_SLEEP         != config->mode
+     && RUUVI_DRIVER_SENSOR_CFG_SINGLE     != config->mode
+     && RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS != config->mode)
+  {
+    err_code |= RUUVI_DRIVER_ERROR_INVALID_PARAM;
+  }
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+
+  // Write registers only if settings changed, sensor must sleep while configured.
+  uint8_t mode = RUUVI_DRIVER_SENSOR_CFG_SLEEP;
+  ruuvi_interface_bme280_mode_get(&mode);
+  if(0 != memcmp(&settings, &(dev.settings), sizeof(settings)))
+  {
+    if(RUUVI_DRIVER_SENSOR_CFG_SLEEP != mode)
+    {
+      mode = RUUVI_DRIVER_SENSOR_CFG_SLEEP;
+      err_code |= ruuvi_interface_bme280_mode_set(&mode);
+    }
+    dev.settings = settings;
+    err_code |= bme280_settings_write();
+  }
+  if(RUUVI_DRIVER_SUCCESS == err_code
+     && (mode != config->mode || RUUVI_DRIVER_SENSOR_CFG_SINGLE == config->mode))
+  {
+    err_code |= ruuvi_interface_bme280_mode_set(&(config->mode));
+  }
+
+  // Getters read the shadow registers, read back does not access the bus.
+  err_code |= ruuvi_driver_sensor_configuration_get(sensor, config);
+  return err_code;
+}
+
+/**
+ * Read compensated data from sensor.
+ * Timestamp is tsample if sensor sleeps after single measurement, current time in continuous mode.
+ * Timestamp is left invalid if measurement is ongoing, in which case data is not valid.
+ */
+static ruuvi_driver_status_t bme280_sample_get(struct bme280_data* const comp_data, uint64_t* const timestamp)
+{
+  *timestamp = RUUVI_DRIVER_UINT64_INVALID;
+
+  // Leave data invalid while asynchronous measurement is ongoing.
+  if(NULL != async.callback) { return RUUVI_DRIVER_SUCCESS; }
+
+  ruuvi_driver_status_t err_code = BME_TO_RUUVI_ERROR(bme280_get_sensor_data(BME280_ALL, comp_data, &dev));
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+
+  // Write tsample if we're in single mode, current time if we're in continuous mode
+  // Leave sample time as invalid if forced mode is ongoing.
+  uint8_t mode = 0;
+  ruuvi_interface_bme280_mode_get(&mode);
+  if(RUUVI_DRIVER_SENSOR_CFG_SLEEP == mode)           { *timestamp = tsample; }
+  else if(RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS == mode) { *timestamp = ruuvi_driver_sensor_timestamp_get(); }
+  else { RUUVI_DRIVER_ERROR_CHECK(RUUVI_DRIVER_ERROR_INTERNAL, ~RUUVI_DRIVER_ERROR_FATAL); }
+  return err_code;
+}
+
 ruuvi_driver_status_t ruuvi_interface_bme280_data_get(void* data)
 {
   if(NULL == data) { return RUUVI_DRIVER_ERROR_NULL; }
   ruuvi_interface_environmental_data_t* p_data = (ruuvi_interface_environmental_data_t*)data;
+#ifdef BME280_FLOAT_ENABLE
   struct bme280_data comp_data;
+  uint64_t timestamp;
 
   p_data->timestamp_ms   = RUUVI_DRIVER_UINT64_INVALID;
   p_data->temperature_c  = RUUVI_INTERFACE_ENVIRONMENTAL_INVALID;
   p_data->humidity_rh    = RUUVI_INTERFACE_ENVIRONMENTAL_INVALID;
   p_data->pressure_pa    = RUUVI_INTERFACE_ENVIRONMENTAL_INVALID;
 
-  ruuvi_driver_status_t err_code = BME_TO_RUUVI_ERROR(bme280_get_sensor_data(BME280_ALL, &comp_data, &dev));
-  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+  ruuvi_driver_status_t err_code = bme280_sample_get(&comp_data, &timestamp);
 
-  // Write tsample if we're in single mode, current time if we're in continuous mode
-  // Leave sample time as invalid if forced mode is ongoing.
+  // If we have valid data, return it.
+  if(RUUVI_DRIVER_SUCCESS == err_code && RUUVI_DRIVER_UINT64_INVALID != timestamp)
+  {
+    p_data->timestamp_ms   = timestamp;
+    p_data->temperature_c  = (float) comp_data.temperature;
+    // Skipped channels are left invalid
+    if(BME280_NO_OVERSAMPLING != dev.settings.osr_h) { p_data->humidity_rh = (float) comp_data.humidity; }
+    if(BME280_NO_OVERSAMPLING != dev.settings.osr_p) { p_data->pressure_pa = (float) comp_data.pressure; }
+  }
+#else
+  // Convert to float only at the end
+  ruuvi_interface_environmental_fixed_data_t fixed;
+  ruuvi_driver_status_t err_code = ruuvi_interface_bme280_data_fixed_get(&fixed);
+  ruuvi_interface_environmental_fixed_to_float(&fixed, p_data);
+#endif
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_interface_bme280_data_fixed_get(ruuvi_interface_environmental_fixed_data_t* const data)
+{
+  if(NULL == data) { return RUUVI_DRIVER_ERROR_NULL; }
+  struct bme280_data comp_data;
+  uint64_t timestamp;
+
+  data->timestamp_ms    = RUUVI_DRIVER_UINT64_INVALID;
+  data->temperature_cc  = RUUVI_INTERFACE_ENVIRONMENTAL_FIXED_INVALID_S32;
+  data->humidity_rh1024 = RUUVI_INTERFACE_ENVIRONMENTAL_FIXED_INVALID_U32;
+  data->pressure_pa100  = RUUVI_INTERFACE_ENVIRONMENTAL_FIXED_INVALID_U32;
+
+  ruuvi_driver_status_t err_code = bme280_sample_get(&comp_data, &timestamp);
+
+  // If we have valid data, return it.
+  if(RUUVI_DRIVER_SUCCESS == err_code && RUUVI_DRIVER_UINT64_INVALID != timestamp)
+  {
+    data->timestamp_ms = timestamp;
+#ifdef BME280_FLOAT_ENABLE
+    // Round to nearest, compensated values are within range of output types.
+    double temperature = comp_data.temperature * 100;
+    data->temperature_cc  = (int32_t) (temperature + ((0 > temperature) ? -0.5 : 0.5));
+    uint32_t humidity = (uint32_t)(comp_data.humidity * 1024 + 0.5);
+    uint32_t pressure = (uint32_t)(comp_data.pressure * 100 + 0.5);
+#else
+    // Bosch integer compensation returns 0.01 C and RH-% * 1024.
+    data->temperature_cc  = comp_data.temperature;
+    uint32_t humidity = comp_data.humidity;
+    uint32_t pressure = BME280_PRESSURE_TO_PA100(comp_data.pressure);
+#endif
+    // Skipped channels are left invalid
+    if(BME280_NO_OVERSAMPLING != dev.settings.osr_h) { data->humidity_rh1024 = humidity; }
+    if(BME280_NO_OVERSAMPLING != dev.settings.osr_p) { data->pressure_pa100  = pressure; }
+  }
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_interface_bme280_data_stream_get(ruuvi_interface_environmental_data_t* const data)
+{
+  if(NULL == data) { return RUUVI_DRIVER_ERROR_NULL; }
   uint8_t mode = 0;
   ruuvi_interface_bme280_mode_get(&mode);
-  if(RUUVI_DRIVER_SENSOR_CFG_SLEEP == mode)           { p_data->timestamp_ms = tsample; }
-  else if(RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS == mode) { p_data->timestamp_ms   = ruuvi_driver_sensor_timestamp_get(); }
-  else { RUUVI_DRIVER_ERROR_CHECK(RUUVI_DRIVER_ERROR_INTERNAL, ~RUUVI_DRIVER_ERROR_FATAL); }
+  uint64_t now = ruuvi_driver_sensor_timestamp_get();
+  if(RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS != mode
+     || RUUVI_DRIVER_UINT64_INVALID == stream.start_ms
+     || RUUVI_DRIVER_UINT64_INVALID == now)
+  {
+    return RUUVI_DRIVER_ERROR_INVALID_STATE;
+  }
 
-  // If we have valid data, return it.
-  if(RUUVI_DRIVER_UINT64_INVALID != p_data->timestamp_ms)
+  // Number of latest finished conversion
+  uint64_t elapsed_us = (now - stream.start_ms) * 1000;
+  uint32_t conversion = 0;
+  if(elapsed_us >= stream.meas_us) { conversion = 1 + (elapsed_us - stream.meas_us) / stream.period_us; }
+
+  // Return latest sample without bus access if there is no new settled conversion.
+  if(conversion <= stream.delivered || conversion < stream.settle)
   {
-    p_data->temperature_c  = (float) comp_data.temperature;
-    p_data->humidity_rh    = (float) comp_data.humidity;
-    p_data->pressure_pa    = (float) comp_data.pressure;
+    memcpy(data, &(stream.latest), sizeof(stream.latest));
+    return RUUVI_DRIVER_STATUS_NO_NEW_DATA;
+  }
+
+  ruuvi_driver_status_t err_code = ruuvi_interface_bme280_data_get(data);
+  if(RUUVI_DRIVER_SUCCESS == err_code && RUUVI_DRIVER_UINT64_INVALID != data->timestamp_ms)
+  {
+    data->timestamp_ms = stream.start_ms + (stream.meas_us + (uint64_t)(conversion - 1) * stream.period_us) / 1000;
+    stream.delivered = conversion;
+    memcpy(&(stream.latest), data, sizeof(stream.latest));
   }
   return err_code;
 }
 
+// Conversion time has passed, check status once and deliver sample. Runs in scheduler context.
+static void bme280_single_task(void* p_event_data, uint16_t event_size)
+{
+  if(NULL == p_event_data || sizeof(uint8_t) != event_size) { return; }
+  // Measurement was aborted, or aborted and started again, after timer expired.
+  if(NULL == async.callback || async.sequence != *((uint8_t*)p_event_data)) { return; }
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  uint8_t status = 0;
+  err_code |= BME_TO_RUUVI_ERROR(bme280_get_regs(BME280_STATUS_ADDR, &status, 1, &dev));
+
+  // Data is left invalid if status could not be read or conversion did not finish in maximum conversion time.
+  ruuvi_interface_bme280_sample_cb_t callback = async.callback;
+  async.callback = NULL;
+  bool complete = (RUUVI_DRIVER_SUCCESS == err_code) && !(BME280_STATUS_MEASURING & status);
+  // BME280 returns to sleep after forced sample. If conversion did not finish, put sensor to sleep.
+  if(complete) { shadow.ctrl_meas &= ~BME280_CTRL_MEAS_MODE_MSK; }
+  else { err_code |= bme280_mode_write(BME280_SLEEP_MODE); }
+  ruuvi_interface_environmental_data_t data;
+  tsample = ruuvi_driver_sensor_timestamp_get();
+  if(complete)
+  {
+    err_code |= ruuvi_interface_bme280_data_get(&data);
+  }
+  else
+  {
+    data.timestamp_ms  = RUUVI_DRIVER_UINT64_INVALID;
+    data.temperature_c = RUUVI_INTERFACE_ENVIRONMENTAL_INVALID;
+    data.humidity_rh   = RUUVI_INTERFACE_ENVIRONMENTAL_INVALID;
+    data.pressure_pa   = RUUVI_INTERFACE_ENVIRONMENTAL_INVALID;
+    err_code |= RUUVI_DRIVER_ERROR_TIMEOUT;
+  }
+  RUUVI_DRIVER_ERROR_CHECK(err_code, ~RUUVI_DRIVER_ERROR_FATAL);
+  callback(&data);
+}
+
+// Conversion time has passed, defer the bus access to scheduler.
+static void bme280_single_timeout_handler(void* p_context)
+{
+  uint8_t sequence = async.sequence;
+  ruuvi_platform_scheduler_event_put(&sequence, sizeof(sequence), bme280_single_task);
+}
+
+ruuvi_driver_status_t ruuvi_interface_bme280_single_async(const ruuvi_interface_bme280_sample_cb_t callback)
+{
+  if(NULL == callback) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(NULL == dev.write) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  if(NULL != async.callback) { return RUUVI_DRIVER_ERROR_BUSY; }
+  VERIFY_SENSOR_SLEEPS();
 
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  if(!single_timer_created)
+  {
+    err_code |= ruuvi_platform_timer_create(&bme280_single_timer, RUUVI_INTERFACE_TIMER_MODE_SINGLE_SHOT, bme280_single_timeout_handler);
+    if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+    single_timer_created = true;
+  }
 
+  err_code |= bme280_mode_write(BME280_FORCED_MODE);
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+  async.callback = callback;
+  async.sequence++;
+  err_code |= ruuvi_platform_timer_start(bme280_single_timer, bme280_max_meas_time());
+  if(RUUVI_DRIVER_SUCCESS != err_code) { async.callback = NULL; }
+  return err_code;
+}
 
-#endif
\ No newline at end of file
+#endif
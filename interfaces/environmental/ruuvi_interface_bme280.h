@@ -9,9 +9,59 @@
 #define RUUVI_INTERFACE_BME280_H
 #include "ruuvi_driver_error.h"
 #include "ruuvi_driver_sensor.h"
+#include "ruuvi_interface_environmental.h"
+#include <stddef.h>
+
+/** Oversampling value of a skipped channel, distinct from RUUVI_DRIVER_SENSOR_CFG_* and RUUVI_DRIVER_SENSOR_ERR_* values **/
+#define RUUVI_INTERFACE_BME280_OVERSAMPLING_SKIP 0xD0
+
+/**
+ * Number of samples per channel: RUUVI_INTERFACE_BME280_OVERSAMPLING_SKIP, 1, 2, 4, 8 or 16.
+ * RUUVI_DRIVER_SENSOR_CFG_DEFAULT and MIN select 1, MAX selects 16 and NO_CHANGE keeps current setting.
+ * Skipped channels are not measured and are returned as invalid.
+ */
+typedef struct {
+  uint8_t temperature;
+  uint8_t pressure;
+  uint8_t humidity;
+}ruuvi_interface_bme280_oversampling_t;
+
+#define RUUVI_INTERFACE_BME280_CALIBRATION_CACHE_KEY 0x424D4532 // "BME2"
+#define RUUVI_INTERFACE_BME280_CALIBRATION_WORDS 10
+
+/**
+ * Calibration parameters and CRC verdict of a sensor kept over warm boots in retained RAM or flash.
+ * Entry is valid if key is RUUVI_INTERFACE_BME280_CALIBRATION_CACHE_KEY and check matches the other fields,
+ * so uninitialized memory after a cold boot is not mistaken for valid calibration.
+ */
+typedef struct {
+  uint32_t key;     // RUUVI_INTERFACE_BME280_CALIBRATION_CACHE_KEY
+  uint8_t handle;   // Chip select of sensor
+  uint8_t chip_id;  // Chip ID read from sensor
+  uint32_t calibration[RUUVI_INTERFACE_BME280_CALIBRATION_WORDS]; // Parsed calibration of Bosch driver
+  uint32_t check;   // Check of other fields
+}ruuvi_interface_bme280_calibration_cache_t;
+
+/**
+ * Called when asynchronous single measurement is ready.
+ */
+typedef void(*ruuvi_interface_bme280_sample_cb_t)(const ruuvi_interface_environmental_data_t* const data);
 
 void bosch_delay_ms(uint32_t time_ms);
 ruuvi_driver_status_t ruuvi_interface_bme280_init(ruuvi_driver_sensor_t* environmental_sensor, ruuvi_driver_bus_t bus, uint8_t handle);
+
+/**
+ * Give storage for calibration parameters. Init reads only the chip ID of a sensor which has valid calibration
+ * in cache, and skips calibration readout and CRC self-test. Calibration is stored after the CRC self-test passes.
+ * Place the cache in memory which is retained over soft resets, or in flash, to speed up warm boots.
+ * Invalidate the cache, for example by clearing it, to read the calibration again.
+ *
+ * parameter cache: array of entries, NULL to stop using cache.
+ * parameter entries: number of entries in cache, one per sensor.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if cache is NULL and entries is not 0
+ */
+ruuvi_driver_status_t ruuvi_interface_bme280_calibration_cache_set(ruuvi_interface_bme280_calibration_cache_t* const cache, const size_t entries);
 ruuvi_driver_status_t ruuvi_interface_bme280_uninit(ruuvi_driver_sensor_t* environmental_sensor, ruuvi_driver_bus_t bus, uint8_t handle);
 ruuvi_driver_status_t ruuvi_interface_bme280_samplerate_set(uint8_t* samplerate);
 ruuvi_driver_status_t ruuvi_interface_bme280_samplerate_get(uint8_t* samplerate);
@@ -25,4 +75,109 @@ ruuvi_driver_status_t ruuvi_interface_bme280_mode_set(uint8_t*);
 ruuvi_driver_status_t ruuvi_interface_bme280_mode_get(uint8_t*);
 ruuvi_driver_status_t ruuvi_interface_bme280_data_get(void* data);
 
-#endif
\ No newline at end of file
+/**
+ * Apply whole configuration at once. Configuration is validated before the sensor is accessed,
+ * nothing is written if any value is not supported. Registers are written in one burst only if they change,
+ * and mode is changed only if needed. Sensor is put to sleep while registers are written.
+ *
+ * parameter sensor: sensor interface of BME280.
+ * parameter config: input: requested configuration. Output: applied configuration, read from RAM shadow.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if sensor or config is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if sensor is not initialized
+ * return: RUUVI_DRIVER_ERROR_BUSY if asynchronous measurement is ongoing
+ * return: RUUVI_DRIVER_ERROR_NOT_SUPPORTED or RUUVI_DRIVER_ERROR_INVALID_PARAM if configuration is invalid
+ * return: error code from stack on error.
+ */
+ruuvi_driver_status_t ruuvi_interface_bme280_configuration_set(const ruuvi_driver_sensor_t* sensor, ruuvi_driver_sensor_configuration_t* config);
+
+
+/**
+ * Take a single measurement without blocking.
+ * Starts forced mode conversion and returns immediately. Once the maximum conversion time has passed,
+ * timer schedules the readout: status register is checked once and compensated sample is passed to callback
+ * in scheduler context. If conversion is still running, sensor is put to sleep and sample is invalid.
+ * Data_get returns invalid data while measurement is ongoing. Setting mode to sleep aborts measurement.
+ * Timers and scheduler must be initialized.
+ *
+ * parameter callback: function to call with the sample. Sample is invalid if conversion did not finish.
+ * return: RUUVI_DRIVER_SUCCESS if measurement was started
+ * return: RUUVI_DRIVER_ERROR_NULL if callback is NULL
+ * return: RUUVI_DRIVER_ERROR_BUSY if measurement is already ongoing
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if sensor is not initialized or is not in sleep mode
+ * return: error code from stack on error.
+ */
+ruuvi_driver_status_t ruuvi_interface_bme280_single_async(const ruuvi_interface_bme280_sample_cb_t callback);
+
+/**
+ * Read configuration registers from sensor into RAM shadow.
+ * Mode checks and getters use the shadow and do not access the bus. Shadow is kept in sync
+ * by the driver, revalidate only if sensor may have been reconfigured or reset by other means.
+ *
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if sensor is not initialized
+ * return: error code from stack on error.
+ */
+ruuvi_driver_status_t ruuvi_interface_bme280_shadow_revalidate(void);
+
+/**
+ * Get latest sample as fixed-point data.
+ * Uses Bosch integer compensation if BME280_FLOAT_ENABLE is not defined, avoiding floating point math.
+ * Timestamp follows the same rules as ruuvi_interface_bme280_data_get.
+ *
+ * parameter data: pointer to fixed-point data to fill. Values are invalid if there is no sample.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if data is NULL
+ * return: error code from stack on error.
+ */
+ruuvi_driver_status_t ruuvi_interface_bme280_data_fixed_get(ruuvi_interface_environmental_fixed_data_t* const data);
+
+/**
+ * Set oversampling of each channel separately. Sensor must be in sleep.
+ * Values are rounded up to next supported value and the actual values are written back.
+ * RUUVI_DRIVER_SENSOR_CFG_DEFAULT, _MIN, _MAX and _NO_CHANGE are supported for each channel.
+ * Temperature is required by pressure and humidity compensation and cannot be skipped.
+ * ruuvi_interface_bme280_dsp_set overrides these settings with same oversampling on every channel,
+ * ruuvi_interface_bme280_dsp_get reports highest oversampling of the channels.
+ *
+ * parameter oversampling: input: requested oversampling. Output: applied oversampling.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if oversampling is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if sensor is not in sleep
+ * return: RUUVI_DRIVER_ERROR_NOT_SUPPORTED if any value is not supported, nothing is applied in this case.
+ */
+ruuvi_driver_status_t ruuvi_interface_bme280_oversampling_set(ruuvi_interface_bme280_oversampling_t* const oversampling);
+
+/**
+ * Get oversampling of each channel.
+ *
+ * parameter oversampling: filled with number of samples per channel, RUUVI_INTERFACE_BME280_OVERSAMPLING_SKIP if skipped.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if oversampling is NULL
+ */
+ruuvi_driver_status_t ruuvi_interface_bme280_oversampling_get(ruuvi_interface_bme280_oversampling_t* const oversampling);
+
+/**
+ * Get maximum duration of one measurement with current oversampling settings, including margin.
+ * Only enabled channels are accounted for.
+ *
+ * return: maximum measurement time in milliseconds.
+ */
+uint32_t ruuvi_interface_bme280_measurement_time_get(void);
+
+/**
+ * Get latest normal mode conversion, reading the sensor only if a new conversion is due.
+ * Conversion times are reconstructed from the time normal mode was entered, configured oversampling and
+ * standby time, instead of using the time of read. Conversions before IIR filter reaches 75 % of step response
+ * are not returned. Reconstructed times drift with sensor oscillator, set continuous mode again to resynchronize.
+ *
+ * parameter data: filled with latest sample. If there is no new sample, previously returned sample is copied.
+ * return: RUUVI_DRIVER_SUCCESS if new sample was read
+ * return: RUUVI_DRIVER_STATUS_NO_NEW_DATA if there is no new conversion since last call
+ * return: RUUVI_DRIVER_ERROR_NULL if data is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if sensor is not in continuous mode or timestamps are not available
+ * return: error code from stack on error.
+ */
+ruuvi_driver_status_t ruuvi_interface_bme280_data_stream_get(ruuvi_interface_environmental_data_t* const data);
+
+#endif
@@ -10,6 +10,8 @@
 #include <stdint.h>
 
 #define RUUVI_INTERFACE_ENVIRONMENTAL_INVALID RUUVI_DRIVER_FLOAT_INVALID
+#define RUUVI_INTERFACE_ENVIRONMENTAL_FIXED_INVALID_S32 INT32_MIN
+#define RUUVI_INTERFACE_ENVIRONMENTAL_FIXED_INVALID_U32 UINT32_MAX
 
 typedef struct
 {
@@ -19,4 +21,34 @@ typedef struct
   float pressure_pa;     // Pa
 }ruuvi_interface_environmental_data_t;
 
-#endif
\ No newline at end of file
+/**
+ * Fixed-point environmental data, allows processing samples without floating point math.
+ * Invalid values are marked with RUUVI_INTERFACE_ENVIRONMENTAL_FIXED_INVALID_S32 or _U32.
+ */
+typedef struct
+{
+  uint64_t timestamp_ms;     // ms since boot
+  int32_t  temperature_cc;   // 0.01 C
+  uint32_t humidity_rh1024;  // RH-% * 1024
+  uint32_t pressure_pa100;   // Pa * 100
+}ruuvi_interface_environmental_fixed_data_t;
+
+/**
+ * Convert fixed-point data to floating point data. Invalid values are converted to invalid values.
+ *
+ * parameter fixed: fixed-point data to convert.
+ * parameter data: floating point data to fill.
+ */
+static inline void ruuvi_interface_environmental_fixed_to_float(const ruuvi_interface_environmental_fixed_data_t* const fixed,
+                                                                ruuvi_interface_environmental_data_t* const data)
+{
+  data->timestamp_ms  = fixed->timestamp_ms;
+  data->temperature_c = (RUUVI_INTERFACE_ENVIRONMENTAL_FIXED_INVALID_S32 == fixed->temperature_cc) ?
+                        RUUVI_INTERFACE_ENVIRONMENTAL_INVALID : fixed->temperature_cc / 100.0f;
+  data->humidity_rh   = (RUUVI_INTERFACE_ENVIRONMENTAL_FIXED_INVALID_U32 == fixed->humidity_rh1024) ?
+                        RUUVI_INTERFACE_ENVIRONMENTAL_INVALID : fixed->humidity_rh1024 / 1024.0f;
+  data->pressure_pa   = (RUUVI_INTERFACE_ENVIRONMENTAL_FIXED_INVALID_U32 == fixed->pressure_pa100) ?
+                        RUUVI_INTERFACE_ENVIRONMENTAL_INVALID : fixed->pressure_pa100 / 100.0f;
+}
+
+#endif
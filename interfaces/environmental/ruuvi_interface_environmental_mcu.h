@@ -23,4 +23,16 @@ ruuvi_driver_status_t ruuvi_interface_environmental_mcu_mode_set(uint8_t*);
 ruuvi_driver_status_t ruuvi_interface_environmental_mcu_mode_get(uint8_t*);
 ruuvi_driver_status_t ruuvi_interface_environmental_mcu_data_get(void* data);
 
+/**
+ * Apply whole configuration at once. Fixed settings are validated before mode is applied.
+ *
+ * parameter sensor: environmental sensor interface.
+ * parameter config: input: requested configuration. Output: applied configuration.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if sensor or config is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if sensor is not initialized
+ * return: RUUVI_DRIVER_ERROR_NOT_SUPPORTED if configuration cannot be applied
+ */
+ruuvi_driver_status_t ruuvi_interface_environmental_mcu_configuration_set(const ruuvi_driver_sensor_t* sensor, ruuvi_driver_sensor_configuration_t* config);
+
 #endif
\ No newline at end of file
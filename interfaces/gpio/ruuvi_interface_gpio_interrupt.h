@@ -54,4 +54,14 @@ ruuvi_driver_status_t ruuvi_platform_gpio_interrupt_enable(uint8_t pin,
                                                            ruuvi_interface_gpio_mode_t mode, 
                                                            ruuvi_interface_gpio_interrupt_fp_t handler);
 
+/**
+ * Disable interrupt on a pin and release the pin, so interrupt can be enabled again with another handler.
+ *
+ * parameter pin: pin to release
+ *
+ * Return RUUVI_DRIVER_SUCCESS on success
+ * Return RUUVI_DRIVER_ERROR_INVALID_PARAM if pin is out of interrupt table
+ */
+ruuvi_driver_status_t ruuvi_platform_gpio_interrupt_disable(uint8_t pin);
+
 #endif
\ No newline at end of file
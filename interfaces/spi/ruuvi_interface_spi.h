@@ -19,11 +19,18 @@ typedef enum {
   RUUVI_INTERFACE_SPI_MODE_3
 }ruuvi_interface_spi_mode_t;
 
+// Platform returns RUUVI_DRIVER_ERROR_NOT_SUPPORTED on frequencies its peripheral cannot run at.
+// New values are appended to keep existing values stable, order does not follow frequency.
 typedef enum {
   RUUVI_INTERFACE_SPI_FREQUENCY_1M,
   RUUVI_INTERFACE_SPI_FREQUENCY_2M,
   RUUVI_INTERFACE_SPI_FREQUENCY_4M,
   RUUVI_INTERFACE_SPI_FREQUENCY_8M,
+  RUUVI_INTERFACE_SPI_FREQUENCY_125K,
+  RUUVI_INTERFACE_SPI_FREQUENCY_250K,
+  RUUVI_INTERFACE_SPI_FREQUENCY_500K,
+  RUUVI_INTERFACE_SPI_FREQUENCY_16M,
+  RUUVI_INTERFACE_SPI_FREQUENCY_32M
 }ruuvi_interface_spi_frequency_t;
 
 typedef struct{
@@ -36,6 +43,69 @@ typedef struct{
   ruuvi_interface_spi_mode_t mode;
 }ruuvi_interface_spi_init_config_t;
 
+/**
+ * Clock and mode of one device on bus, selected by its slave select pin.
+ * Devices without profile use frequency and mode of ruuvi_interface_spi_init_config_t.
+ */
+typedef struct{
+  uint8_t ss_pin;                            // slave select pin of device
+  ruuvi_interface_spi_frequency_t frequency;
+  ruuvi_interface_spi_mode_t mode;
+}ruuvi_interface_spi_profile_t;
+
+/**
+ * One segment of scatter-gather transfer. Segment clocks MAX(tx_len, rx_len) bytes like ruuvi_platform_spi_xfer_blocking.
+ */
+typedef struct{
+  const uint8_t* tx;  // data to send, can be NULL if tx_len is 0
+  size_t tx_len;      // length of data to send
+  uint8_t* rx;        // data to receive, can be NULL if rx_len is 0
+  size_t rx_len;      // length of data to receive
+}ruuvi_interface_spi_segment_t;
+
+/**
+ * Called when asynchronous transaction is complete.
+ *
+ * parameter status: RUUVI_DRIVER_SUCCESS if transaction was clocked, error code otherwise.
+ * parameter p_context: context given in transaction.
+ */
+typedef void(*ruuvi_interface_spi_cb_t)(const ruuvi_driver_status_t status, void* p_context);
+
+/**
+ * Priority of asynchronous transaction. High priority transactions run before waiting blocking transfers
+ * and queued low priority transactions. Transaction already on bus is never interrupted.
+ */
+typedef enum {
+  RUUVI_INTERFACE_SPI_PRIORITY_LOW,
+  RUUVI_INTERFACE_SPI_PRIORITY_HIGH,
+  RUUVI_INTERFACE_SPI_PRIORITIES
+}ruuvi_interface_spi_priority_t;
+
+/**
+ * Asynchronous transaction. Transaction clocks MAX(tx_len, rx_len) bytes like ruuvi_platform_spi_xfer_blocking,
+ * with slave select asserted for the duration of transaction.
+ */
+typedef struct{
+  uint8_t ss_pin;                      // slave select pin, active low
+  const uint8_t* tx;                   // data to send, can be NULL if tx_len is 0. Must stay valid until callback.
+  size_t tx_len;                       // length of data to send
+  uint8_t* rx;                         // data to receive, can be NULL if rx_len is 0. Must stay valid until callback.
+  size_t rx_len;                       // length of data to receive
+  ruuvi_interface_spi_cb_t callback;   // called in interrupt context on completion, can be NULL
+  void* p_context;                     // passed to callback
+  ruuvi_interface_spi_priority_t priority;
+}ruuvi_interface_spi_transaction_t;
+
+/**
+ * Transfer counters of SPI driver.
+ */
+typedef struct{
+  uint32_t transactions; // number of transfers started on peripheral
+  uint32_t segments;     // number of scatter-gather segments
+  uint32_t bytes;        // number of bytes clocked
+  uint32_t reconfigurations; // number of times bus was reconfigured for a device profile
+}ruuvi_interface_spi_stats_t;
+
 /**
  * Initialize SPI driver with default settings
  *
@@ -44,6 +114,46 @@ typedef struct{
  **/
  ruuvi_driver_status_t ruuvi_platform_spi_init(const ruuvi_interface_spi_init_config_t* config);
 
+/**
+ * Take ownership of bus for blocking transfers. Owner can call blocking and scatter-gather transfers and acquire again,
+ * other contexts wait or get RUUVI_DRIVER_ERROR_BUSY until owner has called ruuvi_platform_spi_release as many times as acquire.
+ * In thread mode function waits for the bus. In interrupt context function returns RUUVI_DRIVER_ERROR_BUSY if bus is in use,
+ * queue a high priority asynchronous transaction instead. Waiting thread goes before queued low priority transactions.
+ * ruuvi_platform_spi_xfer_blocking and ruuvi_platform_spi_xfer_sg acquire and release the bus for their duration.
+ *
+ * Blocking transfers wait for SPI interrupt, so they can be called from interrupts below SPI interrupt priority only.
+ * Transfers return RUUVI_DRIVER_ERROR_INVALID_STATE without touching the bus if SPI interrupt cannot preempt the caller,
+ * for example with interrupts disabled or at or above SPI interrupt priority.
+ *
+ * return: RUUVI_DRIVER_SUCCESS if bus is owned by caller
+ * return: RUUVI_DRIVER_ERROR_BUSY if called from interrupt while bus is in use
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if SPI is not initialized, or if bus is in use by a queued transaction
+ *         in thread mode while SPI interrupt cannot run, for example with interrupts disabled
+ **/
+ruuvi_driver_status_t ruuvi_platform_spi_acquire(void);
+
+/**
+ * Give up ownership taken with ruuvi_platform_spi_acquire. Queued transactions start when last acquisition is released.
+ *
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if caller does not own the bus
+ **/
+ruuvi_driver_status_t ruuvi_platform_spi_release(void);
+
+/**
+ * Register clock and mode for device behind given slave select pin. Registering same pin again replaces its profile.
+ * Bus is reconfigured before a scatter-gather or asynchronous transaction only if its device needs a different
+ * profile than the previous transaction. ruuvi_platform_spi_xfer_blocking does not select a device and runs with current profile.
+ *
+ * parameter profile: profile to register, copied by driver.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if profile is NULL
+ * return: RUUVI_DRIVER_ERROR_NOT_SUPPORTED if platform does not support frequency or mode of profile
+ * return: RUUVI_DRIVER_ERROR_NO_MEM if there is no room for new profile
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if SPI is not initialized
+ **/
+ruuvi_driver_status_t ruuvi_platform_spi_profile_register(const ruuvi_interface_spi_profile_t* const profile);
+
 /**
  * Full-duplex SPI. Clocks out MAX(tx_len, rx_len) bytes. It is allowed to send different length transactions, tx will clock out 0xFF if there is
  * less bytes in TX than RX. Does not use slave select pins. RX will start at the same time as TX, i.e. one byte address + read commands will generally have
@@ -56,4 +166,48 @@ typedef struct{
  *
  **/
 ruuvi_driver_status_t ruuvi_platform_spi_xfer_blocking(const uint8_t* tx, const size_t tx_len, uint8_t* rx, const size_t rx_len);
+
+/**
+ * Scatter-gather SPI. Asserts slave select, clocks given segments back to back and releases slave select.
+ * Segments are merged into one transfer when they fit into driver buffers, otherwise each segment is transferred separately
+ * while slave select stays asserted. Function is blocking and will not sleep while transaction is ongoing.
+ *
+ * parameter ss_pin: slave select pin, active low.
+ * parameter segments: array of segments to transfer in order
+ * parameter count: number of segments
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if segments or buffer of a segment is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_PARAM if count is 0
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if SPI is not initialized or SPI interrupt cannot preempt caller
+ * return: RUUVI_DRIVER_ERROR_BUSY if called from interrupt while bus is in use
+ * return: error code from stack on error.
+ **/
+ruuvi_driver_status_t ruuvi_platform_spi_xfer_sg(const uint8_t ss_pin, const ruuvi_interface_spi_segment_t* const segments, const size_t count);
+
+/**
+ * Queue asynchronous SPI transaction. Transactions are clocked in queue order back to back from SPI interrupt,
+ * so several reads from different devices can be chained while the CPU sleeps. Transaction is copied into queue,
+ * buffers must stay valid until callback is called.
+ *
+ * Transactions are queued by priority, see ruuvi_interface_spi_priority_t and ruuvi_platform_spi_acquire.
+ * Function can be called from any context.
+ *
+ * parameter transaction: transaction to queue.
+ * return: RUUVI_DRIVER_SUCCESS if transaction was queued
+ * return: RUUVI_DRIVER_ERROR_NULL if transaction or one of its buffers is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_LENGTH if transaction is longer than a single transfer of driver
+ * return: RUUVI_DRIVER_ERROR_NO_MEM if queue is full
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if SPI is not initialized
+ **/
+ruuvi_driver_status_t ruuvi_platform_spi_xfer_async(const ruuvi_interface_spi_transaction_t* const transaction);
+
+/**
+ * Get or reset transfer counters of SPI driver.
+ *
+ * parameter stats: Output, counters since boot or last reset.
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if stats is NULL
+ **/
+ruuvi_driver_status_t ruuvi_platform_spi_stats_get(ruuvi_interface_spi_stats_t* const stats);
+void ruuvi_platform_spi_stats_reset(void);
 #endif
\ No newline at end of file
@@ -9,27 +9,46 @@
 
 #include "ruuvi_boards.h"
 #include "ruuvi_driver_error.h"
-#include "ruuvi_interface_gpio.h"
 #include "ruuvi_interface_spi.h"
+#include "ruuvi_interface_spi_bme280.h"
 #include "ruuvi_interface_yield.h"
 
+static ruuvi_interface_spi_bme280_stats_t stats = {0};
 
 int8_t ruuvi_interface_spi_bme280_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len)
 {
   ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
-  err_code |= ruuvi_platform_gpio_write(dev_id, RUUVI_INTERFACE_GPIO_LOW);
-  err_code |= ruuvi_platform_spi_xfer_blocking(&reg_addr, 1, NULL, 0);
-  err_code |= ruuvi_platform_spi_xfer_blocking(reg_data, len, NULL, 0);
-  err_code |= ruuvi_platform_gpio_write(dev_id, RUUVI_INTERFACE_GPIO_HIGH);
+  const ruuvi_interface_spi_segment_t segments[] = {
+    { .tx = &reg_addr, .tx_len = 1 },
+    { .tx = reg_data,  .tx_len = len }
+  };
+  err_code |= ruuvi_platform_spi_xfer_sg(dev_id, segments, sizeof(segments) / sizeof(segments[0]));
+  stats.transactions++;
+  stats.bytes += 1 + len;
   return (RUUVI_DRIVER_SUCCESS == err_code) ? 0 : -1;
 }
 
 int8_t ruuvi_interface_spi_bme280_read (uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len)
 {
   ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
-  err_code |= ruuvi_platform_gpio_write(dev_id, RUUVI_INTERFACE_GPIO_LOW);
-  err_code |= ruuvi_platform_spi_xfer_blocking(&reg_addr, 1, NULL, 0);
-  err_code |= ruuvi_platform_spi_xfer_blocking(NULL, 0, reg_data, len);
-  err_code |= ruuvi_platform_gpio_write(dev_id, RUUVI_INTERFACE_GPIO_HIGH);
+  const ruuvi_interface_spi_segment_t segments[] = {
+    { .tx = &reg_addr, .tx_len = 1 },
+    { .rx = reg_data,  .rx_len = len }
+  };
+  err_code |= ruuvi_platform_spi_xfer_sg(dev_id, segments, sizeof(segments) / sizeof(segments[0]));
+  stats.transactions++;
+  stats.bytes += 1 + len;
   return (RUUVI_DRIVER_SUCCESS == err_code) ? 0 : -1;
-}
\ No newline at end of file
+}
+
+ruuvi_driver_status_t ruuvi_interface_spi_bme280_stats_get(ruuvi_interface_spi_bme280_stats_t* const p_stats)
+{
+  if(NULL == p_stats) { return RUUVI_DRIVER_ERROR_NULL; }
+  memcpy(p_stats, &stats, sizeof(stats));
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+void ruuvi_interface_spi_bme280_stats_reset(void)
+{
+  memset(&stats, 0, sizeof(stats));
+}
@@ -12,8 +12,27 @@
 #include <stddef.h>
 #include <stdint.h>
 
+/** Bus traffic generated by BME280 wrappers **/
+typedef struct {
+  uint32_t transactions; //!< Number of chip-select cycles, i.e. read and write calls
+  uint32_t bytes;        //!< Number of bytes transferred including register address
+}ruuvi_interface_spi_bme280_stats_t;
+
 // Wrappers for BME280
 int8_t ruuvi_interface_spi_bme280_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len);
 int8_t ruuvi_interface_spi_bme280_read (uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len);
 
+/**
+ * Get bus traffic counters of BME280 wrappers.
+ *
+ * parameter p_stats: pointer to structure which will be filled with counters.
+ * return: RUUVI_DRIVER_SUCCESS on success, RUUVI_DRIVER_ERROR_NULL if p_stats is NULL.
+ */
+ruuvi_driver_status_t ruuvi_interface_spi_bme280_stats_get(ruuvi_interface_spi_bme280_stats_t* const p_stats);
+
+/**
+ * Reset bus traffic counters of BME280 wrappers to 0.
+ */
+void ruuvi_interface_spi_bme280_stats_reset(void);
+
 #endif
\ No newline at end of file
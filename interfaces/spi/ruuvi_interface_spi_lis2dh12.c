@@ -9,7 +9,6 @@
 
 #include "ruuvi_boards.h"
 #include "ruuvi_driver_error.h"
-#include "ruuvi_interface_gpio.h"
 #include "ruuvi_interface_spi.h"
 
 
@@ -22,10 +21,11 @@ int32_t ruuvi_interface_spi_lis2dh12_write(void* dev_ptr, uint8_t reg_addr, uint
   // bit 1: MS bit. When 0, does not increment the address; when 1, increments the address in
   // multiple read / writes.
   if (len > 1) { reg_addr |= 0x40; }
-  err_code |= ruuvi_platform_gpio_write(dev_id, RUUVI_INTERFACE_GPIO_LOW);
-  err_code |= ruuvi_platform_spi_xfer_blocking(&reg_addr, 1, NULL, 0);
-  err_code |= ruuvi_platform_spi_xfer_blocking(reg_data, len, NULL, 0);
-  err_code |= ruuvi_platform_gpio_write(dev_id, RUUVI_INTERFACE_GPIO_HIGH);
+  const ruuvi_interface_spi_segment_t segments[] = {
+    { .tx = &reg_addr, .tx_len = 1 },
+    { .tx = reg_data,  .tx_len = len }
+  };
+  err_code |= ruuvi_platform_spi_xfer_sg(dev_id, segments, sizeof(segments) / sizeof(segments[0]));
   return err_code;
 }
 
@@ -38,9 +38,10 @@ int32_t ruuvi_interface_spi_lis2dh12_read (void* dev_ptr, uint8_t reg_addr, uint
   // bit 1: MS bit. When 0, does not increment the address; when 1, increments the address in
   // multiple read / writes.
   if (len > 1) { reg_addr |= 0x40; }
-  err_code |= ruuvi_platform_gpio_write(dev_id, RUUVI_INTERFACE_GPIO_LOW);
-  err_code |= ruuvi_platform_spi_xfer_blocking(&reg_addr, 1, NULL, 0);
-  err_code |= ruuvi_platform_spi_xfer_blocking(NULL, 0, reg_data, len);
-  err_code |= ruuvi_platform_gpio_write(dev_id, RUUVI_INTERFACE_GPIO_HIGH);
+  const ruuvi_interface_spi_segment_t segments[] = {
+    { .tx = &reg_addr, .tx_len = 1 },
+    { .rx = reg_data,  .rx_len = len }
+  };
+  err_code |= ruuvi_platform_spi_xfer_sg(dev_id, segments, sizeof(segments) / sizeof(segments[0]));
   return err_code;
 }
\ No newline at end of file
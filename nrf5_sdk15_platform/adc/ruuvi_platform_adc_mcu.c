@@ -52,11 +52,20 @@
 #include "ruuvi_interface_adc_mcu.h"
 
 #include "nrf_drv_saadc.h"
+#include "nrf_drv_ppi.h"
+#include "nrf_drv_timer.h"
 
 #include <string.h>
 
 #define RUUVI_PLATFORM_ADC_NRF52832_DEFAULT_RESOLUTION 10
 
+// Hardware timer triggering continuous sampling, must be enabled in application sdk_config along with PPI.
+#ifndef RUUVI_PLATFORM_ADC_NRF52832_TIMER_INSTANCE
+#define RUUVI_PLATFORM_ADC_NRF52832_TIMER_INSTANCE 1
+#endif
+#define RUUVI_PLATFORM_ADC_NRF52832_MAX_SAMPLERATE 200   // Hz
+#define RUUVI_PLATFORM_ADC_NRF52832_MAX_BATCH      32767 // Samples, limited by EasyDMA
+
 #define ADC_REF_VOLTAGE_IN_VOLTS  0.600f  // Reference voltage (in milli volts) used by ADC while doing conversion.
 #define ADC_PRE_SCALING_COMPENSATION 6.0f    // The ADC is configured to use channel with prescaling as input. And hence the result of conversion is to be multiplied by prescaling to get the actual value of the voltage.
 
@@ -84,13 +93,27 @@ static float adc_volts;                  // Value of last sample in volts.
 static uint64_t adc_tsample;             // Time when sample was taken
 static nrf_drv_saadc_config_t adc_config = NRF_DRV_SAADC_DEFAULT_CONFIG; // Structure for ADC configuration
 
-static float raw_adc_to_volts(nrf_saadc_value_t adc)
+// Continuous sampling triggered by timer through PPI into two batch buffers.
+static const nrf_drv_timer_t adc_timer = NRF_DRV_TIMER_INSTANCE(RUUVI_PLATFORM_ADC_NRF52832_TIMER_INSTANCE);
+static nrf_ppi_channel_t adc_ppi_channel;
+static uint8_t adc_samplerate = RUUVI_DRIVER_SENSOR_CFG_DEFAULT; // Hz, default samples on data_get
+static bool adc_continuous = false;                              // Timer triggered sampling is running
+static nrf_saadc_value_t* p_batch = NULL;                        // 2 * batch_size samples
+static size_t batch_size = 0;
+static ruuvi_interface_adc_mcu_batch_cb_t batch_cb = NULL;
+
+static float adc_volts_per_lsb(void)
 {
   // Get ADC max value into counts
   uint8_t resolution;
   ruuvi_interface_adc_mcu_resolution_get(&resolution);
   uint16_t counts = 1<<resolution;
-  return (ADC_REF_VOLTAGE_IN_VOLTS * ((float)adc/(float)counts) * ADC_PRE_SCALING_COMPENSATION);
+  return (ADC_REF_VOLTAGE_IN_VOLTS * ADC_PRE_SCALING_COMPENSATION) / (float)counts;
+}
+
+static float raw_adc_to_volts(nrf_saadc_value_t adc)
+{
+  return (float)adc * adc_volts_per_lsb();
 }
 
 static void nrf52832_adc_sample(void)
@@ -101,15 +124,100 @@ static void nrf52832_adc_sample(void)
 }
 
 /**@brief Function handling events from 'nrf_drv_saadc.c'.
- * No implementation needed
+ * Hands full batch buffer to application and queues it again while the other buffer is being filled.
  *
  * @param[in] p_evt SAADC event.
  */
 static void saadc_event_handler(nrf_drv_saadc_evt_t const * p_evt)
 {
-  if (p_evt->type == NRF_DRV_SAADC_EVT_DONE)
+  if (p_evt->type == NRF_DRV_SAADC_EVT_DONE && adc_continuous)
+  {
+    nrf_saadc_value_t* const buffer = p_evt->data.done.p_buffer;
+    const uint16_t size = p_evt->data.done.size;
+    adc_tsample = ruuvi_driver_sensor_timestamp_get();
+    adc_volts = raw_adc_to_volts(buffer[size - 1]);
+    if(NULL != batch_cb)
+    {
+      ruuvi_interface_adc_raw_info_t info = {
+        .timestamp_ms  = adc_tsample,
+        .samplerate_hz = adc_samplerate,
+        .v_per_lsb     = adc_volts_per_lsb()
+      };
+      batch_cb(buffer, size, &info);
+    }
+    nrf_drv_saadc_buffer_convert(buffer, size);
+  }
+}
+
+// Timer only triggers SAADC through PPI, no interrupt handling is needed.
+static void adc_timer_handler(nrf_timer_event_t event_type, void* p_context)
+{
+}
+
+static void adc_continuous_stop(void)
+{
+  nrf_drv_timer_disable(&adc_timer);
+  nrf_drv_ppi_channel_disable(adc_ppi_channel);
+  nrf_drv_ppi_channel_free(adc_ppi_channel);
+  nrf_drv_timer_uninit(&adc_timer);
+  adc_continuous = false;
+  nrf_drv_saadc_abort();
+  nrf_saadc_burst_set(0, NRF_SAADC_BURST_DISABLED);
+}
+
+// Start timer triggered sampling into batch buffers at adc_samplerate.
+static ruuvi_driver_status_t adc_continuous_start(void)
+{
+  ret_code_t err_code = NRF_SUCCESS;
+  nrf_drv_timer_config_t timer_config = NRF_DRV_TIMER_DEFAULT_CONFIG;
+  timer_config.bit_width = NRF_TIMER_BIT_WIDTH_32;
+  err_code = nrf_drv_timer_init(&adc_timer, &timer_config, adc_timer_handler);
+  if(NRF_SUCCESS != err_code) { return ruuvi_platform_to_ruuvi_error(&err_code); }
+  uint32_t ticks = nrf_drv_timer_us_to_ticks(&adc_timer, 1000000UL / adc_samplerate);
+  nrf_drv_timer_extended_compare(&adc_timer, NRF_TIMER_CC_CHANNEL0, ticks, NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK, false);
+
+  // PPI may be initialized by other modules already
+  err_code = nrf_drv_ppi_init();
+  if(NRF_ERROR_MODULE_ALREADY_INITIALIZED == err_code) { err_code = NRF_SUCCESS; }
+  if(NRF_SUCCESS == err_code) { err_code = nrf_drv_ppi_channel_alloc(&adc_ppi_channel); }
+  if(NRF_SUCCESS != err_code)
   {
+    nrf_drv_timer_uninit(&adc_timer);
+    return ruuvi_platform_to_ruuvi_error(&err_code);
   }
+  adc_continuous = true;
+  err_code |= nrf_drv_ppi_channel_assign(adc_ppi_channel,
+                                         nrf_drv_timer_event_address_get(&adc_timer, NRF_TIMER_EVENT_COMPARE0),
+                                         nrf_drv_saadc_sample_task_get());
+  // Oversampled value needs all samples of the average on one trigger
+  if(NRF_SAADC_OVERSAMPLE_DISABLED != adc_config.oversample) { nrf_saadc_burst_set(0, NRF_SAADC_BURST_ENABLED); }
+  err_code |= nrf_drv_saadc_buffer_convert(&p_batch[0], batch_size);
+  err_code |= nrf_drv_saadc_buffer_convert(&p_batch[batch_size], batch_size);
+  err_code |= nrf_drv_ppi_channel_enable(adc_ppi_channel);
+  if(NRF_SUCCESS != err_code)
+  {
+    adc_continuous_stop();
+    return ruuvi_platform_to_ruuvi_error(&err_code);
+  }
+  nrf_drv_timer_enable(&adc_timer);
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+// Converts ruuvi samplerate to Hz of continuous sampling, writes back actual samplerate.
+static ruuvi_driver_status_t samplerate_to_hz(uint8_t* const samplerate, uint8_t* const hz)
+{
+  if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == *samplerate) { *samplerate = *hz; }
+  else if(RUUVI_DRIVER_SENSOR_CFG_DEFAULT == *samplerate) { *hz = RUUVI_DRIVER_SENSOR_CFG_DEFAULT; }
+  else if(RUUVI_DRIVER_SENSOR_CFG_MIN == *samplerate) { *hz = 1; }
+  else if(RUUVI_DRIVER_SENSOR_CFG_MAX == *samplerate) { *hz = RUUVI_PLATFORM_ADC_NRF52832_MAX_SAMPLERATE; }
+  else if(RUUVI_PLATFORM_ADC_NRF52832_MAX_SAMPLERATE >= *samplerate) { *hz = *samplerate; }
+  else
+  {
+    *samplerate = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED;
+    return RUUVI_DRIVER_ERROR_NOT_SUPPORTED;
+  }
+  *samplerate = *hz;
+  return RUUVI_DRIVER_SUCCESS;
 }
 
 // Converts Ruuvi ADC channel to nRF adc channel
@@ -196,12 +304,137 @@ static uint8_t nrf_to_ruuvi_resolution(const nrf_saadc_resolution_t resolution)
   }
 }
 
+// Converts ruuvi resolution into given SAADC configuration, writes back actual resolution.
+static ruuvi_driver_status_t resolution_to_config(uint8_t* const resolution, nrf_drv_saadc_config_t* const config)
+{
+  if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == *resolution)
+  {
+    *resolution = nrf_to_ruuvi_resolution(config->resolution);
+    return RUUVI_DRIVER_SUCCESS;
+  }
+  if(RUUVI_DRIVER_SENSOR_CFG_MIN == *resolution)
+  {
+    *resolution = 8;
+    config->resolution = NRF_SAADC_RESOLUTION_8BIT;
+  }
+  else if(RUUVI_DRIVER_SENSOR_CFG_MAX == *resolution)
+  {
+    *resolution = 14;
+    config->resolution = NRF_SAADC_RESOLUTION_14BIT;
+  }
+  else if(RUUVI_DRIVER_SENSOR_CFG_DEFAULT == *resolution)
+  {
+    *resolution = RUUVI_PLATFORM_ADC_NRF52832_DEFAULT_RESOLUTION;
+    config->resolution = ruuvi_to_nrf_resolution(*resolution);
+  }
+  else if(8 >= *resolution )  { config->resolution = NRF_SAADC_RESOLUTION_8BIT;  *resolution = 8; }
+  else if(10 >= *resolution ) { config->resolution = NRF_SAADC_RESOLUTION_10BIT; *resolution = 10; }
+  else if(12 >= *resolution ) { config->resolution = NRF_SAADC_RESOLUTION_12BIT; *resolution = 12; }
+  else if(14 >= *resolution ) { config->resolution = NRF_SAADC_RESOLUTION_14BIT; *resolution = 14; }
+  else
+  {
+    *resolution = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED;
+    return RUUVI_DRIVER_ERROR_NOT_SUPPORTED;
+  }
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+// Converts ruuvi DSP function into given SAADC configuration, writes back actual DSP.
+static ruuvi_driver_status_t dsp_to_config(uint8_t* const dsp, uint8_t* const parameter, nrf_drv_saadc_config_t* const config)
+{
+  uint8_t dsp_original = *dsp;
+  uint8_t parameter_original = *parameter;
+  if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == dsp_original)
+  {
+    return ruuvi_interface_adc_mcu_dsp_get(dsp, parameter);
+  }
+
+  // Set new values if applicable
+  if(RUUVI_DRIVER_SENSOR_DSP_LAST == dsp_original ||
+     RUUVI_DRIVER_SENSOR_CFG_DEFAULT == dsp_original)
+  {
+    config->oversample = NRF_SAADC_OVERSAMPLE_DISABLED;
+    *parameter = 1;
+    *dsp = RUUVI_DRIVER_SENSOR_DSP_LAST;
+    return RUUVI_DRIVER_SUCCESS;
+  }
+  // 128 is maximum we support
+  if((RUUVI_DRIVER_SENSOR_DSP_OS == dsp_original) &&
+     (128 >= parameter_original))
+  {
+    if(1 >= parameter_original)
+    {
+      config->oversample = NRF_SAADC_OVERSAMPLE_DISABLED;
+      *dsp = RUUVI_DRIVER_SENSOR_DSP_LAST;
+      *parameter = 1;
+    }
+    else if(2 >= parameter_original)
+    {
+      config->oversample = NRF_SAADC_OVERSAMPLE_2X;
+      *parameter = 2;
+    }
+    else if(4 >= parameter_original)
+    {
+      config->oversample = NRF_SAADC_OVERSAMPLE_4X;
+      *parameter = 4;
+    }
+    else if(8 >= parameter_original)
+    {
+      config->oversample = NRF_SAADC_OVERSAMPLE_8X;
+      *parameter = 8;
+    }
+    else if(16 >= parameter_original)
+    {
+      config->oversample = NRF_SAADC_OVERSAMPLE_16X;
+      *parameter = 16;
+    }
+    else if(32 >= parameter_original)
+    {
+      config->oversample = NRF_SAADC_OVERSAMPLE_32X;
+      *parameter = 32;
+    }
+    else if(64 >= parameter_original)
+    {
+      config->oversample = NRF_SAADC_OVERSAMPLE_64X;
+      *parameter = 64;
+    }
+    else
+    {
+      config->oversample = NRF_SAADC_OVERSAMPLE_128X;
+      *parameter = 128;
+    }
+    return RUUVI_DRIVER_SUCCESS;
+  }
+
+  // Report actual values on error
+  ruuvi_interface_adc_mcu_dsp_get(dsp, parameter);
+  return RUUVI_DRIVER_ERROR_NOT_SUPPORTED;
+}
+
+// Returns true if parameter is one of the values which are accepted for fixed settings
+static bool is_ignored(const uint8_t param)
+{
+  return RUUVI_DRIVER_SENSOR_CFG_DEFAULT   == param ||
+         RUUVI_DRIVER_SENSOR_CFG_MIN       == param ||
+         RUUVI_DRIVER_SENSOR_CFG_MAX       == param ||
+         RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == param;
+}
+
+// Configure channel 0 through driver, driver keeps track of active channels for buffer conversions.
+static ret_code_t adc_channel_init(void)
+{
+  nrf_saadc_channel_config_t ch_config = NRF_DRV_SAADC_DEFAULT_CHANNEL_CONFIG_SE(ruuvi_to_nrf_adc_channel(adc_channel));
+  ch_config.gain =  NRF_SAADC_GAIN1_6;
+  return nrf_drv_saadc_channel_init(0, &ch_config);
+}
+
 // Uninitializes and reinitializes ADC to apply new configuration
 static ruuvi_driver_status_t reinit_adc(void)
 {
   ret_code_t err_code = NRF_SUCCESS;
   nrf_drv_saadc_uninit();
   err_code |= nrf_drv_saadc_init(&adc_config, saadc_event_handler);
+  if(NRF_SUCCESS == err_code) { err_code |= adc_channel_init(); }
   adc_volts = RUUVI_INTERFACE_ADC_INVALID;
   adc_tsample = RUUVI_DRIVER_UINT64_INVALID;
   autorefresh = false;
@@ -216,15 +449,15 @@ ruuvi_driver_status_t ruuvi_interface_adc_mcu_init(ruuvi_driver_sensor_t* adc_se
   // Support only one instance for now
   if(adc_is_init) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
 
-  // Initialize ADC
+  // Initialize ADC. In low power mode driver triggers every sample of buffer conversion from SAADC interrupt,
+  // timer triggered continuous sampling needs sample task to be triggered by PPI alone.
+  adc_config.low_power_mode = false;
   ret_code_t err_code = nrf_drv_saadc_init(&adc_config, saadc_event_handler);
   if(NRF_SUCCESS == err_code) { adc_is_init = true; }
 
   // Initialize given channel. Only one ADC channel is supported at a time
-  nrf_saadc_channel_config_t ch_config = NRF_DRV_SAADC_DEFAULT_CHANNEL_CONFIG_SE(ruuvi_to_nrf_adc_channel(handle));
-  ch_config.gain =  NRF_SAADC_GAIN1_6;
-  nrf_saadc_channel_init(0, &ch_config);
   adc_channel = handle;
+  if(NRF_SUCCESS == err_code) { err_code |= adc_channel_init(); }
 
   // Setup function pointers
   adc_sensor->init              = ruuvi_interface_adc_mcu_init;
@@ -240,7 +473,7 @@ ruuvi_driver_status_t ruuvi_interface_adc_mcu_init(ruuvi_driver_sensor_t* adc_se
   adc_sensor->mode_set          = ruuvi_interface_adc_mcu_mode_set;
   adc_sensor->mode_get          = ruuvi_interface_adc_mcu_mode_get;
   adc_sensor->data_get          = ruuvi_interface_adc_mcu_data_get;
-  adc_sensor->configuration_set = ruuvi_driver_sensor_configuration_set;
+  adc_sensor->configuration_set = ruuvi_interface_adc_mcu_configuration_set;
   adc_sensor->configuration_get = ruuvi_driver_sensor_configuration_get;
   adc_volts = RUUVI_INTERFACE_ADC_INVALID;
   adc_tsample = RUUVI_DRIVER_UINT64_INVALID;
@@ -252,7 +485,9 @@ ruuvi_driver_status_t ruuvi_interface_adc_mcu_uninit(ruuvi_driver_sensor_t* adc_
 {
   if(NULL == adc_sensor) { return RUUVI_DRIVER_ERROR_NULL; }
   memset(adc_sensor, 0, sizeof(ruuvi_driver_sensor_t));
+  if(adc_continuous) { adc_continuous_stop(); }
   nrf_drv_saadc_uninit();
+  adc_samplerate = RUUVI_DRIVER_SENSOR_CFG_DEFAULT;
   adc_is_init = false;
   autorefresh = false;
   adc_tsample = RUUVI_DRIVER_UINT64_INVALID;
@@ -261,21 +496,29 @@ ruuvi_driver_status_t ruuvi_interface_adc_mcu_uninit(ruuvi_driver_sensor_t* adc_
   return RUUVI_DRIVER_SUCCESS;
 }
 
-// Continuous sampling is not supported (although we could use timer and PPI to implement it), mark pointed value as not supported even if parameter is one of no-changes
+// Default samplerate samples on data_get in continuous mode, other rates are sampled by timer into batch buffers.
 ruuvi_driver_status_t ruuvi_interface_adc_mcu_samplerate_set(uint8_t* samplerate)
 {
   if(NULL == samplerate) { return RUUVI_DRIVER_ERROR_NULL; }
   VERIFY_SENSOR_SLEEPS();
-  uint8_t original = *samplerate;
-  *samplerate = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED;
-  RETURN_SUCCESS_ON_VALID(original);
-  return RUUVI_DRIVER_ERROR_NOT_SUPPORTED;
+  return samplerate_to_hz(samplerate, &adc_samplerate);
 }
 
 ruuvi_driver_status_t ruuvi_interface_adc_mcu_samplerate_get(uint8_t* samplerate)
 {
   if(NULL == samplerate) { return RUUVI_DRIVER_ERROR_NULL; }
-  *samplerate = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED;
+  *samplerate = adc_samplerate;
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+ruuvi_driver_status_t ruuvi_interface_adc_mcu_batch_set(int16_t* const buffer, const size_t samples, const ruuvi_interface_adc_mcu_batch_cb_t callback)
+{
+  if(NULL == buffer || NULL == callback) { return RUUVI_DRIVER_ERROR_NULL; }
+  VERIFY_SENSOR_SLEEPS();
+  if(0 == samples || RUUVI_PLATFORM_ADC_NRF52832_MAX_BATCH < samples) { return RUUVI_DRIVER_ERROR_INVALID_LENGTH; }
+  p_batch = buffer;
+  batch_size = samples;
+  batch_cb = callback;
   return RUUVI_DRIVER_SUCCESS;
 }
 
@@ -284,30 +527,8 @@ ruuvi_driver_status_t ruuvi_interface_adc_mcu_resolution_set(uint8_t* resolution
   if(NULL == resolution) { return RUUVI_DRIVER_ERROR_NULL; }
   VERIFY_SENSOR_SLEEPS();
   if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == *resolution)    { return ruuvi_interface_adc_mcu_resolution_get(resolution); }
-  if(RUUVI_DRIVER_SENSOR_CFG_MIN == *resolution)
-  {
-    *resolution = 8;
-    adc_config.resolution = NRF_SAADC_RESOLUTION_8BIT;
-  }
-  else if(RUUVI_DRIVER_SENSOR_CFG_MAX == *resolution)
-  {
-    *resolution = 14;
-    adc_config.resolution = NRF_SAADC_RESOLUTION_14BIT;
-  }
-  else if(RUUVI_DRIVER_SENSOR_CFG_DEFAULT == *resolution)
-  {
-    *resolution = RUUVI_PLATFORM_ADC_NRF52832_DEFAULT_RESOLUTION;
-    adc_config.resolution = ruuvi_to_nrf_resolution(*resolution);
-  }
-  else if(8 >= *resolution )  { adc_config.resolution = NRF_SAADC_RESOLUTION_8BIT;  *resolution = 8; }
-  else if(10 >= *resolution ) { adc_config.resolution = NRF_SAADC_RESOLUTION_10BIT; *resolution = 10; }
-  else if(12 >= *resolution ) { adc_config.resolution = NRF_SAADC_RESOLUTION_12BIT; *resolution = 12; }
-  else if(14 >= *resolution ) { adc_config.resolution = NRF_SAADC_RESOLUTION_14BIT; *resolution = 14; }
-  else
-  {
-    *resolution = RUUVI_DRIVER_SENSOR_ERR_NOT_SUPPORTED;
-    return RUUVI_DRIVER_ERROR_NOT_SUPPORTED;
-  }
+  ruuvi_driver_status_t err_code = resolution_to_config(resolution, &adc_config);
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
 
   // Uninit and reinit adc with new settings.
   return reinit_adc();
@@ -345,67 +566,9 @@ ruuvi_driver_status_t ruuvi_interface_adc_mcu_dsp_set(uint8_t* dsp, uint8_t* par
 {
   if(NULL == dsp || NULL == parameter) { return RUUVI_DRIVER_ERROR_NULL; }
   VERIFY_SENSOR_SLEEPS();
-  // Store originals
-  uint8_t dsp_original;
-  dsp_original       = *dsp;
-
-  // Ge actual values
-  ruuvi_interface_adc_mcu_dsp_get(dsp, parameter);
-
-  // Set new values if applicable
-  if(RUUVI_DRIVER_SENSOR_DSP_LAST == dsp_original ||
-     RUUVI_DRIVER_SENSOR_CFG_DEFAULT == dsp_original)
-  {
-    adc_config.oversample = NRF_SAADC_OVERSAMPLE_DISABLED;
-    *parameter = 1;
-    *dsp = RUUVI_DRIVER_SENSOR_DSP_LAST;
-    reinit_adc();
-    return RUUVI_DRIVER_SUCCESS;
-  }
-  // 128 is maximum we support
-  if((RUUVI_DRIVER_SENSOR_DSP_OS == dsp_original) &&
-     (128 < *parameter))
-  {
-    if(2 >= *parameter)
-    {
-      adc_config.oversample = NRF_SAADC_OVERSAMPLE_2X;
-      *parameter = 2;
-    }
-    else if(4 >= *parameter)
-    {
-      adc_config.oversample = NRF_SAADC_OVERSAMPLE_4X;
-      *parameter = 4;
-    }
-    else if(8 >= *parameter)
-    {
-      adc_config.oversample = NRF_SAADC_OVERSAMPLE_8X;
-      *parameter = 8;
-    }
-    else if(16 >= *parameter)
-    {
-      adc_config.oversample = NRF_SAADC_OVERSAMPLE_16X;
-      *parameter = 16;
-    }
-    else if(32 >= *parameter)
-    {
-      adc_config.oversample = NRF_SAADC_OVERSAMPLE_32X;
-      *parameter = 32;
-    }
-    else if(64 >= *parameter)
-    {
-      adc_config.oversample = NRF_SAADC_OVERSAMPLE_64X;
-      *parameter = 64;
-    }
-    else if(128 >= *parameter)
-    {
-      adc_config.oversample = NRF_SAADC_OVERSAMPLE_128X;
-      *parameter = 128;
-    }
-    reinit_adc();
-    return RUUVI_DRIVER_SUCCESS;
-  }
-
-  return RUUVI_DRIVER_ERROR_NOT_SUPPORTED;
+  ruuvi_driver_status_t err_code = dsp_to_config(dsp, parameter, &adc_config);
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+  return reinit_adc();
 }
 
 ruuvi_driver_status_t ruuvi_interface_adc_mcu_dsp_get(uint8_t* dsp, uint8_t* parameter)
@@ -465,6 +628,7 @@ ruuvi_driver_status_t ruuvi_interface_adc_mcu_mode_set(uint8_t* mode)
   // Enter sleep by default and by explicit sleep commmand
   if(RUUVI_DRIVER_SENSOR_CFG_SLEEP == *mode || RUUVI_DRIVER_SENSOR_CFG_DEFAULT == *mode)
   {
+    if(adc_continuous) { adc_continuous_stop(); }
     autorefresh = false;
     *mode = RUUVI_DRIVER_SENSOR_CFG_SLEEP;
 
@@ -491,6 +655,21 @@ ruuvi_driver_status_t ruuvi_interface_adc_mcu_mode_set(uint8_t* mode)
   }
   if(RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS == *mode)
   {
+    // Timer triggered sampling needs batch buffers
+    if(RUUVI_DRIVER_SENSOR_CFG_DEFAULT != adc_samplerate && !adc_continuous)
+    {
+      if(NULL == p_batch)
+      {
+        *mode = RUUVI_DRIVER_SENSOR_CFG_SLEEP;
+        return RUUVI_DRIVER_ERROR_INVALID_STATE;
+      }
+      ruuvi_driver_status_t err_code = adc_continuous_start();
+      if(RUUVI_DRIVER_SUCCESS != err_code)
+      {
+        *mode = RUUVI_DRIVER_SENSOR_CFG_SLEEP;
+        return err_code;
+      }
+    }
     autorefresh = true;
     return RUUVI_DRIVER_SUCCESS;
   }
@@ -514,11 +693,55 @@ ruuvi_driver_status_t ruuvi_interface_adc_mcu_mode_get(uint8_t* mode)
 }
 
 
+ruuvi_driver_status_t ruuvi_interface_adc_mcu_configuration_set(const ruuvi_driver_sensor_t* sensor, ruuvi_driver_sensor_configuration_t* config)
+{
+  if(NULL == sensor || NULL == config) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(!adc_is_init) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+
+  // Validate everything on a copy of configuration
+  nrf_drv_saadc_config_t new_config = adc_config;
+  uint8_t samplerate = adc_samplerate;
+  err_code |= samplerate_to_hz(&(config->samplerate), &samplerate);
+  if(!is_ignored(config->scale)) { err_code |= RUUVI_DRIVER_ERROR_NOT_SUPPORTED; }
+  err_code |= resolution_to_config(&(config->resolution), &new_config);
+  err_code |= dsp_to_config(&(config->dsp_function), &(config->dsp_parameter), &new_config);
+  if(RUUVI_DRIVER_SENSOR_CFG_DEFAULT       != config->mode
+     && RUUVI_DRIVER_SENSOR_CFG_SLEEP      != config->mode
+     && RUUVI_DRIVER_SENSOR_CFG_SINGLE     != config->mode
+     && RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS != config->mode
+     && RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE  != config->mode)
+  {
+    err_code |= RUUVI_DRIVER_ERROR_INVALID_PARAM;
+  }
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+
+  // Reinitialize SAADC only if configuration changed, reinit leaves ADC in sleep.
+  uint8_t mode = config->mode;
+  if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == mode) { ruuvi_interface_adc_mcu_mode_get(&mode); }
+  if(adc_continuous) { adc_continuous_stop(); }
+  adc_samplerate = samplerate;
+  if(0 != memcmp(&new_config, &adc_config, sizeof(adc_config)))
+  {
+    adc_config = new_config;
+    err_code |= reinit_adc();
+  }
+  else
+  {
+    autorefresh = false;
+  }
+  err_code |= ruuvi_interface_adc_mcu_mode_set(&mode);
+  config->mode = mode;
+  config->scale = 3;
+  return err_code;
+}
+
 ruuvi_driver_status_t ruuvi_interface_adc_mcu_data_get(void* data)
 {
   if(NULL == data) { return RUUVI_DRIVER_ERROR_NULL; }
   ruuvi_interface_adc_data_t* adc = (ruuvi_interface_adc_data_t*) data;
-  if(autorefresh) { nrf52832_adc_sample(); }
+  // Timer triggered sampling updates latest sample on every batch.
+  if(autorefresh && !adc_continuous) { nrf52832_adc_sample(); }
   adc->timestamp_ms  = RUUVI_DRIVER_UINT64_INVALID;
   adc->reserved0     = RUUVI_INTERFACE_ADC_INVALID;
   adc->reserved1     = RUUVI_INTERFACE_ADC_INVALID;
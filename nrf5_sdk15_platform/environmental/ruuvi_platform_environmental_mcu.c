@@ -136,7 +136,7 @@ ruuvi_driver_status_t ruuvi_interface_environmental_mcu_init(ruuvi_driver_sensor
   environmental_sensor->mode_set          = ruuvi_interface_environmental_mcu_mode_set;
   environmental_sensor->mode_get          = ruuvi_interface_environmental_mcu_mode_get;
   environmental_sensor->data_get          = ruuvi_interface_environmental_mcu_data_get;
-  environmental_sensor->configuration_set = ruuvi_driver_sensor_configuration_set;
+  environmental_sensor->configuration_set = ruuvi_interface_environmental_mcu_configuration_set;
   environmental_sensor->configuration_get = ruuvi_driver_sensor_configuration_get;
   sensor_is_init = true;
 
@@ -293,6 +293,41 @@ ruuvi_driver_status_t ruuvi_interface_environmental_mcu_mode_get(uint8_t* mode)
   return RUUVI_DRIVER_SUCCESS;
 }
 
+// Returns true if parameter is one of the values which are accepted for fixed settings
+static bool is_ignored(const uint8_t param)
+{
+  return RUUVI_DRIVER_SENSOR_CFG_DEFAULT   == param ||
+         RUUVI_DRIVER_SENSOR_CFG_MIN       == param ||
+         RUUVI_DRIVER_SENSOR_CFG_MAX       == param ||
+         RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == param;
+}
+
+// Only mode is configurable, validate fixed settings and apply mode.
+ruuvi_driver_status_t ruuvi_interface_environmental_mcu_configuration_set(const ruuvi_driver_sensor_t* sensor, ruuvi_driver_sensor_configuration_t* config)
+{
+  if(NULL == sensor || NULL == config) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(!sensor_is_init) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  if(!is_ignored(config->samplerate)) { err_code |= RUUVI_DRIVER_ERROR_NOT_SUPPORTED; }
+  if(!is_ignored(config->resolution) && 10 != config->resolution) { err_code |= RUUVI_DRIVER_ERROR_NOT_SUPPORTED; }
+  if(!is_ignored(config->scale) && 128 < config->scale) { err_code |= RUUVI_DRIVER_ERROR_NOT_SUPPORTED; }
+  if(!is_ignored(config->dsp_function) && RUUVI_DRIVER_SENSOR_DSP_LAST != config->dsp_function) { err_code |= RUUVI_DRIVER_ERROR_NOT_SUPPORTED; }
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+
+  uint8_t mode = config->mode;
+  if(RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE == mode) { ruuvi_interface_environmental_mcu_mode_get(&mode); }
+  // Single sample is taken from sleep
+  if(RUUVI_DRIVER_SENSOR_CFG_SINGLE == mode) { autorefresh = false; }
+  err_code |= ruuvi_interface_environmental_mcu_mode_set(&mode);
+  config->mode = mode;
+  config->samplerate = RUUVI_DRIVER_SENSOR_CFG_DEFAULT;
+  config->resolution = 10;
+  config->scale = 128;
+  config->dsp_function = RUUVI_DRIVER_SENSOR_DSP_LAST;
+  config->dsp_parameter = 1;
+  return err_code;
+}
+
 ruuvi_driver_status_t ruuvi_interface_environmental_mcu_data_get(void* data)
 {
   if(NULL == data) { return RUUVI_DRIVER_ERROR_NULL; }
@@ -126,4 +126,13 @@ ruuvi_driver_status_t ruuvi_platform_gpio_interrupt_enable(uint8_t pin,
   return ruuvi_platform_to_ruuvi_error(&err_code);
 }
 
+ruuvi_driver_status_t ruuvi_platform_gpio_interrupt_disable(uint8_t pin)
+{
+  if(max_interrupts <= pin) { return RUUVI_DRIVER_ERROR_INVALID_PARAM; }
+  nrf_drv_gpiote_in_event_disable(pin);
+  nrf_drv_gpiote_in_uninit(pin);
+  pin_event_handlers[pin] = NULL;
+  return RUUVI_DRIVER_SUCCESS;
+}
+
 #endif
\ No newline at end of file
@@ -51,8 +51,51 @@
 #include "nrf_gpio.h"
 
 
+// EasyDMA transfer length is limited to 255 bytes on nRF52832.
+#define SPI_SG_BUFFER_SIZE 255
+#define SPI_MAX_XFER_LEN   255
+// Number of queued asynchronous transactions, must be a power of two.
+#define SPI_QUEUE_SIZE     8
+// Number of device profiles on bus
+#define SPI_PROFILES       4
+
 static const nrf_drv_spi_t spi = NRF_DRV_SPI_INSTANCE(SPI_INSTANCE);  /**< SPI instance. */
 static bool  spi_init_done = false;
+static ruuvi_interface_spi_stats_t stats = {0};
+static uint8_t sg_tx[SPI_SG_BUFFER_SIZE]; // Merged TX of scatter-gather segments
+static uint8_t sg_rx[SPI_SG_BUFFER_SIZE]; // Merged RX of scatter-gather segments
+
+// Owner of the bus. Ownership is taken with compare-and-swap from SPI_OWNER_FREE, whoever frees the bus hands it to next queued transaction.
+#define SPI_OWNER_FREE     0
+#define SPI_OWNER_ASYNC    1 // Transaction from queue is on bus
+#define SPI_OWNER_BLOCKING 2 // Blocking transfers of owner_context own the bus
+#define SPI_NO_CONTEXT     UINT32_MAX
+
+// Queue of asynchronous transactions of one priority. Written under critical region, read by bus owner.
+typedef struct{
+  ruuvi_interface_spi_transaction_t transactions[SPI_QUEUE_SIZE];
+  volatile uint8_t head;   // Free-running write counter
+  volatile uint8_t tail;   // Free-running read counter, head of queue is on bus while it is active
+}spi_queue_t;
+
+static spi_queue_t queues[RUUVI_INTERFACE_SPI_PRIORITIES];
+static spi_queue_t* volatile p_active = NULL;       // Queue whose transaction is on bus
+static uint8_t bus_owner = SPI_OWNER_FREE;
+static volatile uint32_t owner_context = SPI_NO_CONTEXT; // Exception number of blocking owner, 0 in thread mode
+static uint8_t owner_depth = 0;                     // Nested acquisitions of blocking owner
+static uint8_t waiting = 0;                         // Blocking acquirers waiting for the bus in thread mode
+static volatile bool transfer_done = true;          // Blocking transfer has completed
+
+// Device profiles converted to driver values. Bus runs with active configuration until next device needs other profile.
+typedef struct{
+  uint8_t ss_pin;
+  nrf_drv_spi_frequency_t frequency;
+  nrf_drv_spi_mode_t mode;
+}spi_profile_t;
+static spi_profile_t profiles[SPI_PROFILES];
+static uint8_t profile_count = 0;
+static spi_profile_t bus_default;            // Profile of devices without registered profile
+static nrf_drv_spi_config_t active_config;   // Configuration driver is initialized with
 
 static ruuvi_driver_status_t ruuvi_to_nrf_spi_mode(const ruuvi_interface_spi_mode_t ruuvi_mode, nrf_drv_spi_mode_t* nrf_mode)
 {
@@ -79,10 +122,22 @@ static ruuvi_driver_status_t ruuvi_to_nrf_spi_mode(const ruuvi_interface_spi_mod
   }
 }
 
-static ruuvi_driver_status_t ruuvi_to_nrf_spi_freq(const ruuvi_interface_spi_mode_t ruuvi_freq, nrf_drv_spi_frequency_t* nrf_freq)
+static ruuvi_driver_status_t ruuvi_to_nrf_spi_freq(const ruuvi_interface_spi_frequency_t ruuvi_freq, nrf_drv_spi_frequency_t* nrf_freq)
 {
   switch(ruuvi_freq)
   {
+    case RUUVI_INTERFACE_SPI_FREQUENCY_125K:
+      *nrf_freq = NRF_DRV_SPI_FREQ_125K;
+      return RUUVI_DRIVER_SUCCESS;
+
+    case RUUVI_INTERFACE_SPI_FREQUENCY_250K:
+      *nrf_freq = NRF_DRV_SPI_FREQ_250K;
+      return RUUVI_DRIVER_SUCCESS;
+
+    case RUUVI_INTERFACE_SPI_FREQUENCY_500K:
+      *nrf_freq = NRF_DRV_SPI_FREQ_500K;
+      return RUUVI_DRIVER_SUCCESS;
+
     case RUUVI_INTERFACE_SPI_FREQUENCY_1M:
       *nrf_freq = NRF_DRV_SPI_FREQ_1M;
       return RUUVI_DRIVER_SUCCESS;
@@ -99,12 +154,145 @@ static ruuvi_driver_status_t ruuvi_to_nrf_spi_freq(const ruuvi_interface_spi_mod
       *nrf_freq = NRF_DRV_SPI_FREQ_8M;
       return RUUVI_DRIVER_SUCCESS;
 
+    // SPIM of nRF52832 runs at 8 MHz at most.
+    case RUUVI_INTERFACE_SPI_FREQUENCY_16M:
+    case RUUVI_INTERFACE_SPI_FREQUENCY_32M:
+      return RUUVI_DRIVER_ERROR_NOT_SUPPORTED;
+
     default:
       return RUUVI_DRIVER_ERROR_INVALID_PARAM;
   }
 }
 
 
+static void spi_event_handler(nrf_drv_spi_evt_t const * p_event, void * p_context);
+static void spi_async_kick(void);
+
+// Reconfigure bus if device behind ss_pin needs other profile than the active one. Bus must be idle.
+static ruuvi_driver_status_t spi_profile_apply(const uint8_t ss_pin)
+{
+  const spi_profile_t* profile = &bus_default;
+  for(uint8_t ii = 0; ii < profile_count; ii++)
+  {
+    if(ss_pin == profiles[ii].ss_pin) { profile = &profiles[ii]; break; }
+  }
+  if(profile->frequency == active_config.frequency && profile->mode == active_config.mode) { return RUUVI_DRIVER_SUCCESS; }
+
+  nrf_drv_spi_uninit(&spi);
+  active_config.frequency = profile->frequency;
+  active_config.mode = profile->mode;
+  ret_code_t err_code = nrf_drv_spi_init(&spi, &active_config, spi_event_handler, NULL);
+  stats.reconfigurations++;
+  return ruuvi_platform_to_ruuvi_error(&err_code);
+}
+
+static bool spi_bus_try_acquire(const uint8_t owner)
+{
+  uint8_t expected = SPI_OWNER_FREE;
+  return __atomic_compare_exchange_n(&bus_owner, &expected, owner, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+// Free the bus and hand it over to next queued transaction, if any.
+static void spi_bus_free(void)
+{
+  __atomic_store_n(&bus_owner, SPI_OWNER_FREE, __ATOMIC_SEQ_CST);
+  spi_async_kick();
+}
+
+// Queue to run next. High priority transactions go first, then blocking transfers waiting in thread mode, then low priority transactions.
+static spi_queue_t* spi_queue_next(void)
+{
+  spi_queue_t* const high = &queues[RUUVI_INTERFACE_SPI_PRIORITY_HIGH];
+  if(high->head != high->tail) { return high; }
+  spi_queue_t* const low = &queues[RUUVI_INTERFACE_SPI_PRIORITY_LOW];
+  if(low->head != low->tail && 0 == __atomic_load_n(&waiting, __ATOMIC_SEQ_CST)) { return low; }
+  return NULL;
+}
+
+// Release slave select of completed transaction, hand bus over and notify the owner of transaction.
+static void spi_async_complete(const ruuvi_driver_status_t status)
+{
+  spi_queue_t* const queue = p_active;
+  const ruuvi_interface_spi_transaction_t done = queue->transactions[queue->tail & (SPI_QUEUE_SIZE - 1)];
+  nrf_gpio_pin_set(done.ss_pin);
+  queue->tail++;
+  p_active = NULL;
+  spi_bus_free();
+  if(NULL != done.callback) { done.callback(status, done.p_context); }
+}
+
+// Start transaction at the head of queue. Caller must own the bus as SPI_OWNER_ASYNC.
+static void spi_async_start(spi_queue_t* const queue)
+{
+  const ruuvi_interface_spi_transaction_t* const next = &queue->transactions[queue->tail & (SPI_QUEUE_SIZE - 1)];
+  p_active = queue;
+  ruuvi_driver_status_t status = spi_profile_apply(next->ss_pin);
+  if(RUUVI_DRIVER_SUCCESS != status)
+  {
+    spi_async_complete(status);
+    return;
+  }
+  nrf_gpio_pin_clear(next->ss_pin);
+  stats.transactions++;
+  stats.bytes += (next->tx_len > next->rx_len) ? next->tx_len : next->rx_len;
+  ret_code_t err_code = nrf_drv_spi_transfer(&spi, next->tx, next->tx_len, next->rx, next->rx_len);
+  if(NRF_SUCCESS != err_code) { spi_async_complete(ruuvi_platform_to_ruuvi_error(&err_code)); }
+}
+
+// Start next queued transaction if bus is free. Called by whoever queues work or frees the bus, so work queued
+// while bus is owned is started by the owner on release.
+static void spi_async_kick(void)
+{
+  while(NULL != spi_queue_next() && spi_bus_try_acquire(SPI_OWNER_ASYNC))
+  {
+    // Queue may have been drained by previous owner between check and acquire.
+    spi_queue_t* const next = spi_queue_next();
+    if(NULL != next)
+    {
+      spi_async_start(next);
+      return;
+    }
+    __atomic_store_n(&bus_owner, SPI_OWNER_FREE, __ATOMIC_SEQ_CST);
+  }
+}
+
+static void spi_event_handler(nrf_drv_spi_evt_t const * p_event, void * p_context)
+{
+  if(SPI_OWNER_ASYNC == __atomic_load_n(&bus_owner, __ATOMIC_SEQ_CST)) { spi_async_complete(RUUVI_DRIVER_SUCCESS); }
+  else { transfer_done = true; }
+}
+
+// Return true if SPI interrupt can preempt the caller, i.e. waiting for transfer completion cannot hang.
+static bool spi_irq_can_preempt(void)
+{
+  const IRQn_Type spi_irq = nrfx_get_irq_number(spi.u.spi.p_reg);
+  // Interrupts disabled, or SPI interrupt disabled for example by SoftDevice critical region
+  if(__get_PRIMASK() || !NVIC_GetEnableIRQ(spi_irq)) { return false; }
+  const uint32_t context = __get_IPSR();
+  if(0 == context) { return true; }
+  // NMI and HardFault have fixed priority above all interrupts
+  if(4 > context) { return false; }
+  return NVIC_GetPriority(spi_irq) < NVIC_GetPriority((IRQn_Type)((int32_t)context - 16));
+}
+
+// Transfer on claimed bus and wait for completion.
+static ruuvi_driver_status_t spi_transfer_wait(const uint8_t* tx, const size_t tx_len, uint8_t* rx, const size_t rx_len)
+{
+  if (SPI_MAX_XFER_LEN < tx_len || SPI_MAX_XFER_LEN < rx_len) { return RUUVI_DRIVER_ERROR_INVALID_LENGTH; }
+  // Completion is signalled from SPI interrupt, refuse to start a transfer which could never complete.
+  if (!spi_irq_can_preempt()) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  transfer_done = false;
+  ret_code_t err_code = nrf_drv_spi_transfer(&spi, tx, tx_len, rx, rx_len);
+  stats.transactions++;
+  stats.bytes += (tx_len > rx_len) ? tx_len : rx_len;
+  if(NRF_SUCCESS == err_code)
+  {
+    while(!transfer_done) { }
+  }
+  transfer_done = true;
+  return ruuvi_platform_to_ruuvi_error(&err_code);
+}
+
 ruuvi_driver_status_t ruuvi_platform_spi_init(const ruuvi_interface_spi_init_config_t* config)
 {
   //Return error if SPI is already init
@@ -129,10 +317,20 @@ ruuvi_driver_status_t ruuvi_platform_spi_init(const ruuvi_interface_spi_init_con
   spi_config.mode         = mode;
   spi_config.bit_order    = NRF_DRV_SPI_BIT_ORDER_MSB_FIRST;
 
-  // Use blocking mode by using NULL as event handler
+  // Use event mode, blocking transfers wait for completion event.
   ret_code_t err_code = NRF_SUCCESS;
-  err_code = nrf_drv_spi_init(&spi, &spi_config, NULL, NULL);
-;
+  err_code = nrf_drv_spi_init(&spi, &spi_config, spi_event_handler, NULL);
+  active_config = spi_config;
+  bus_default.frequency = frequency;
+  bus_default.mode = mode;
+  profile_count = 0;
+  memset(queues, 0, sizeof(queues));
+  p_active = NULL;
+  bus_owner = SPI_OWNER_FREE;
+  owner_context = SPI_NO_CONTEXT;
+  owner_depth = 0;
+  waiting = 0;
+
   for (size_t ii = 0; ii < config->ss_pins_number; ii++)
   {
       nrf_gpio_cfg_output(config->ss_pins[ii]);
@@ -143,15 +341,179 @@ ruuvi_driver_status_t ruuvi_platform_spi_init(const ruuvi_interface_spi_init_con
   return (status | ruuvi_platform_to_ruuvi_error(&err_code));
 }
 
+ruuvi_driver_status_t ruuvi_platform_spi_profile_register(const ruuvi_interface_spi_profile_t* const profile)
+{
+  if (!spi_init_done) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  if (NULL == profile) { return RUUVI_DRIVER_ERROR_NULL; }
+  spi_profile_t converted = { .ss_pin = profile->ss_pin };
+  if(RUUVI_DRIVER_SUCCESS != ruuvi_to_nrf_spi_freq(profile->frequency, &converted.frequency)) { return RUUVI_DRIVER_ERROR_NOT_SUPPORTED; }
+  if(RUUVI_DRIVER_SUCCESS != ruuvi_to_nrf_spi_mode(profile->mode, &converted.mode)) { return RUUVI_DRIVER_ERROR_NOT_SUPPORTED; }
+
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  CRITICAL_REGION_ENTER();
+  uint8_t index = 0;
+  while(index < profile_count && profile->ss_pin != profiles[index].ss_pin) { index++; }
+  if(SPI_PROFILES <= index) { err_code = RUUVI_DRIVER_ERROR_NO_MEM; }
+  else
+  {
+    profiles[index] = converted;
+    if(index == profile_count) { profile_count++; }
+  }
+  CRITICAL_REGION_EXIT();
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_platform_spi_acquire(void)
+{
+  if (!spi_init_done) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  const uint32_t context = __get_IPSR();
+  // Nested acquire by owner. Other contexts cannot see their own number here, it is cleared before bus is freed.
+  if(SPI_OWNER_BLOCKING == __atomic_load_n(&bus_owner, __ATOMIC_SEQ_CST) && context == owner_context)
+  {
+    owner_depth++;
+    return RUUVI_DRIVER_SUCCESS;
+  }
+  if(0 == context && !spi_bus_try_acquire(SPI_OWNER_BLOCKING))
+  {
+    // Queued transaction frees the bus from SPI interrupt, waiting would never end if it cannot run.
+    if(!spi_irq_can_preempt()) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+    // Thread mode can wait, owner in interrupt or queued transaction will free the bus.
+    __atomic_add_fetch(&waiting, 1, __ATOMIC_SEQ_CST);
+    while(!spi_bus_try_acquire(SPI_OWNER_BLOCKING)) { }
+    __atomic_sub_fetch(&waiting, 1, __ATOMIC_SEQ_CST);
+  }
+  // Interrupt would wait forever for the context it preempted.
+  else if(0 != context && !spi_bus_try_acquire(SPI_OWNER_BLOCKING)) { return RUUVI_DRIVER_ERROR_BUSY; }
+  owner_context = context;
+  owner_depth = 1;
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+ruuvi_driver_status_t ruuvi_platform_spi_release(void)
+{
+  if(SPI_OWNER_BLOCKING != __atomic_load_n(&bus_owner, __ATOMIC_SEQ_CST) || __get_IPSR() != owner_context) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  if(0 < --owner_depth) { return RUUVI_DRIVER_SUCCESS; }
+  owner_context = SPI_NO_CONTEXT;
+  spi_bus_free();
+  return RUUVI_DRIVER_SUCCESS;
+}
+
 ruuvi_driver_status_t ruuvi_platform_spi_xfer_blocking(const uint8_t* tx, const size_t tx_len, uint8_t* rx, const size_t rx_len)
 {
   //Return error if not init or if given null pointer
   if (!spi_init_done)            { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
   if ((NULL == tx && 0 != tx_len) || (NULL == rx && 0 != rx_len)) { return RUUVI_DRIVER_ERROR_NULL; }
 
-  ret_code_t err_code = NRF_SUCCESS;
-  err_code |= nrf_drv_spi_transfer(&spi, tx, tx_len, rx, rx_len);
-  return ruuvi_platform_to_ruuvi_error(&err_code);
+  ruuvi_driver_status_t err_code = ruuvi_platform_spi_acquire();
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+  err_code |= spi_transfer_wait(tx, tx_len, rx, rx_len);
+  ruuvi_platform_spi_release();
+  return err_code;
+}
+
+// Clock all segments in one transfer through sg buffers. Segments must fit into buffers.
+static ruuvi_driver_status_t spi_xfer_merged(const ruuvi_interface_spi_segment_t* const segments, const size_t count, const size_t total)
+{
+  size_t offset = 0;
+  for(size_t ii = 0; ii < count; ii++)
+  {
+    const size_t len = (segments[ii].tx_len > segments[ii].rx_len) ? segments[ii].tx_len : segments[ii].rx_len;
+    // Segments without data to send may have NULL tx
+    if(0 < segments[ii].tx_len) { memcpy(&sg_tx[offset], segments[ii].tx, segments[ii].tx_len); }
+    memset(&sg_tx[offset + segments[ii].tx_len], 0xFF, len - segments[ii].tx_len);
+    offset += len;
+  }
+
+  ruuvi_driver_status_t err_code = spi_transfer_wait(sg_tx, total, sg_rx, total);
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+
+  offset = 0;
+  for(size_t ii = 0; ii < count; ii++)
+  {
+    const size_t len = (segments[ii].tx_len > segments[ii].rx_len) ? segments[ii].tx_len : segments[ii].rx_len;
+    if(0 < segments[ii].rx_len) { memcpy(segments[ii].rx, &sg_rx[offset], segments[ii].rx_len); }
+    offset += len;
+  }
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_platform_spi_xfer_sg(const uint8_t ss_pin, const ruuvi_interface_spi_segment_t* const segments, const size_t count)
+{
+  if (!spi_init_done) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  if (NULL == segments) { return RUUVI_DRIVER_ERROR_NULL; }
+  if (0 == count) { return RUUVI_DRIVER_ERROR_INVALID_PARAM; }
+  size_t total = 0;
+  for(size_t ii = 0; ii < count; ii++)
+  {
+    if ((NULL == segments[ii].tx && 0 != segments[ii].tx_len) || (NULL == segments[ii].rx && 0 != segments[ii].rx_len)) { return RUUVI_DRIVER_ERROR_NULL; }
+    total += (segments[ii].tx_len > segments[ii].rx_len) ? segments[ii].tx_len : segments[ii].rx_len;
+  }
+
+  ruuvi_driver_status_t err_code = ruuvi_platform_spi_acquire();
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+  err_code |= spi_profile_apply(ss_pin);
+  if(RUUVI_DRIVER_SUCCESS != err_code)
+  {
+    ruuvi_platform_spi_release();
+    return err_code;
+  }
+  nrf_gpio_pin_clear(ss_pin);
+  // Single segment needs no copying
+  if(1 == count)
+  {
+    err_code |= spi_transfer_wait(segments[0].tx, segments[0].tx_len, segments[0].rx, segments[0].rx_len);
+  }
+  else if(SPI_SG_BUFFER_SIZE >= total)
+  {
+    err_code |= spi_xfer_merged(segments, count, total);
+  }
+  else
+  {
+    for(size_t ii = 0; ii < count && RUUVI_DRIVER_SUCCESS == err_code; ii++)
+    {
+      err_code |= spi_transfer_wait(segments[ii].tx, segments[ii].tx_len, segments[ii].rx, segments[ii].rx_len);
+    }
+  }
+  nrf_gpio_pin_set(ss_pin);
+  ruuvi_platform_spi_release();
+  stats.segments += count;
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_platform_spi_xfer_async(const ruuvi_interface_spi_transaction_t* const transaction)
+{
+  if (!spi_init_done) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  if (NULL == transaction) { return RUUVI_DRIVER_ERROR_NULL; }
+  if ((NULL == transaction->tx && 0 != transaction->tx_len) || (NULL == transaction->rx && 0 != transaction->rx_len)) { return RUUVI_DRIVER_ERROR_NULL; }
+  if (SPI_MAX_XFER_LEN < transaction->tx_len || SPI_MAX_XFER_LEN < transaction->rx_len) { return RUUVI_DRIVER_ERROR_INVALID_LENGTH; }
+  if (RUUVI_INTERFACE_SPI_PRIORITIES <= transaction->priority) { return RUUVI_DRIVER_ERROR_INVALID_PARAM; }
+
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  spi_queue_t* const queue = &queues[transaction->priority];
+  // Producers may preempt each other, slot is reserved and published in one short critical region.
+  CRITICAL_REGION_ENTER();
+  if(SPI_QUEUE_SIZE <= (uint8_t)(queue->head - queue->tail)) { err_code = RUUVI_DRIVER_ERROR_NO_MEM; }
+  else
+  {
+    queue->transactions[queue->head & (SPI_QUEUE_SIZE - 1)] = *transaction;
+    queue->head++;
+  }
+  CRITICAL_REGION_EXIT();
+  // Starts transaction if bus is free, otherwise owner starts it on release.
+  if(RUUVI_DRIVER_SUCCESS == err_code) { spi_async_kick(); }
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_platform_spi_stats_get(ruuvi_interface_spi_stats_t* const p_stats)
+{
+  if(NULL == p_stats) { return RUUVI_DRIVER_ERROR_NULL; }
+  memcpy(p_stats, &stats, sizeof(stats));
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+void ruuvi_platform_spi_stats_reset(void)
+{
+  memset(&stats, 0, sizeof(stats));
 }
 
 #endif
\ No newline at end of file
@@ -34,6 +34,7 @@
 #define RUUVI_DRIVER_ERROR_NOT_IMPLEMENTED (1<<16) ///< Not implemented yet
 #define RUUVI_DRIVER_ERROR_SELFTEST        (1<<17) ///< Self-test fail
 #define RUUVI_DRIVER_STATUS_MORE_AVAILABLE (1<<18) ///< Driver has more data queued
+#define RUUVI_DRIVER_STATUS_NO_NEW_DATA    (1<<19) ///< Driver has no new data since last read
 #define RUUVI_DRIVER_ERROR_FATAL           (1<<31) ///< Program should always reset after this
 
 typedef int32_t ruuvi_driver_status_t;
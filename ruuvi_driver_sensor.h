@@ -54,6 +54,7 @@
 #define RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS      0xF4
 #define RUUVI_DRIVER_SENSOR_CFG_ON_DRDY         0xF5   // Data ready
 #define RUUVI_DRIVER_SENSOR_CFG_ON_INTERRUPT    0xF6   // Configuring interrupts is not yet supported.
+#define RUUVI_DRIVER_SENSOR_CFG_EXTENDED        0xF7   // Value does not fit in configuration, use sensor-specific getter. Has no effect on set.
 #define RUUVI_DRIVER_SENSOR_CFG_NO_CHANGE       0xFF
 
 #define RUUVI_DRIVER_SENSOR_DSP_LAST            0      // Parameter: No effect
@@ -0,0 +1,142 @@
+#include "ruuvi_driver_error.h"
+#include "ruuvi_driver_sensor.h"
+#include "ruuvi_driver_sensor_block.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Convert value to LSBs, rounded to nearest and saturated to [min, max]. Invalid value is stored as invalid.
+static int32_t block_to_fixed(const float value, const float scale, const int32_t min, const int32_t max, const int32_t invalid)
+{
+  if(RUUVI_DRIVER_FLOAT_INVALID == value || isnan(value)) { return invalid; }
+  float lsb = roundf(value / scale);
+  if(lsb <= (float)min) { return min; }
+  if(lsb >= (float)max) { return max; }
+  return (int32_t)lsb;
+}
+
+ruuvi_driver_status_t ruuvi_driver_sensor_block_reset(ruuvi_driver_sensor_block_t* const block)
+{
+  if(NULL == block || NULL == block->values) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(0 == block->channels || RUUVI_DRIVER_SENSOR_BLOCK_CHANNELS < block->channels) { return RUUVI_DRIVER_ERROR_INVALID_PARAM; }
+  if(sizeof(int16_t) != block->width && sizeof(int32_t) != block->width) { return RUUVI_DRIVER_ERROR_INVALID_PARAM; }
+  if(0 == block->capacity) { return RUUVI_DRIVER_ERROR_INVALID_PARAM; }
+  if(NULL == block->deltas && (0 == block->interval_ms || block->interval_ms <= 2U * block->tolerance_ms)) { return RUUVI_DRIVER_ERROR_INVALID_PARAM; }
+  for(uint8_t ii = 0; ii < block->channels; ii++)
+  {
+    if(!(0 < block->scale[ii])) { return RUUVI_DRIVER_ERROR_INVALID_PARAM; }
+  }
+  block->count = 0;
+  block->base_ms = RUUVI_DRIVER_UINT64_INVALID;
+  block->last_ms = RUUVI_DRIVER_UINT64_INVALID;
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+ruuvi_driver_status_t ruuvi_driver_sensor_block_append(ruuvi_driver_sensor_block_t* const block, const ruuvi_driver_sensor_data_t* const data, size_t* const count)
+{
+  if(NULL == block || NULL == data || NULL == count) { return RUUVI_DRIVER_ERROR_NULL; }
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  size_t appended = 0;
+  for(; appended < *count; appended++)
+  {
+    const ruuvi_driver_sensor_data_t* const sample = &(data[appended]);
+    if(block->capacity <= block->count)
+    {
+      err_code = RUUVI_DRIVER_ERROR_NO_MEM;
+      break;
+    }
+    if(RUUVI_DRIVER_UINT64_INVALID == sample->timestamp)
+    {
+      err_code = RUUVI_DRIVER_ERROR_INVALID_DATA;
+      break;
+    }
+    uint16_t delta = 0;
+    if(0 < block->count)
+    {
+      if(sample->timestamp < block->last_ms || (sample->timestamp - block->last_ms) > RUUVI_DRIVER_SENSOR_BLOCK_MAX_DELTA_MS)
+      {
+        err_code = RUUVI_DRIVER_ERROR_INVALID_DATA;
+        break;
+      }
+      delta = (uint16_t)(sample->timestamp - block->last_ms);
+      // Timestamp is not stored in fixed interval, sample must fall on its slot.
+      if(NULL == block->deltas)
+      {
+        const uint64_t expected = block->base_ms + (uint64_t)block->count * block->interval_ms;
+        const uint64_t deviation = (sample->timestamp > expected) ? (sample->timestamp - expected) : (expected - sample->timestamp);
+        if(deviation > block->tolerance_ms)
+        {
+          err_code = RUUVI_DRIVER_ERROR_INVALID_DATA;
+          break;
+        }
+      }
+    }
+    else { block->base_ms = sample->timestamp; }
+    if(NULL != block->deltas) { block->deltas[block->count] = delta; }
+    block->last_ms = sample->timestamp;
+
+    const float values[RUUVI_DRIVER_SENSOR_BLOCK_CHANNELS] = { sample->value0, sample->value1, sample->value2 };
+    const size_t index = (size_t)block->count * block->channels;
+    for(uint8_t ii = 0; ii < block->channels; ii++)
+    {
+      if(sizeof(int16_t) == block->width)
+      {
+        ((int16_t*)block->values)[index + ii] = (int16_t)block_to_fixed(values[ii], block->scale[ii], INT16_MIN + 1, INT16_MAX, RUUVI_DRIVER_SENSOR_BLOCK_INVALID_S16);
+      }
+      else
+      {
+        ((int32_t*)block->values)[index + ii] = block_to_fixed(values[ii], block->scale[ii], INT32_MIN + 1, INT32_MAX, RUUVI_DRIVER_SENSOR_BLOCK_INVALID_S32);
+      }
+    }
+    block->count++;
+  }
+  *count = appended;
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_driver_sensor_block_read(const ruuvi_driver_sensor_block_t* const block, const size_t start, ruuvi_driver_sensor_data_t* const data, size_t* const count)
+{
+  if(NULL == block || NULL == data || NULL == count) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(start >= block->count)
+  {
+    *count = 0;
+    return RUUVI_DRIVER_SUCCESS;
+  }
+  const size_t available = block->count - start;
+  const size_t to_read = (*count < available) ? *count : available;
+
+  // Sum deltas up to first sample read
+  uint64_t timestamp = block->base_ms;
+  if(NULL == block->deltas) { timestamp += (uint64_t)start * block->interval_ms; }
+  else
+  {
+    for(size_t ii = 1; ii <= start; ii++) { timestamp += block->deltas[ii]; }
+  }
+
+  for(size_t ii = 0; ii < to_read; ii++)
+  {
+    const size_t sample = start + ii;
+    if(0 < ii) { timestamp += (NULL == block->deltas) ? block->interval_ms : block->deltas[sample]; }
+    float values[RUUVI_DRIVER_SENSOR_BLOCK_CHANNELS] = { RUUVI_DRIVER_FLOAT_INVALID, RUUVI_DRIVER_FLOAT_INVALID, RUUVI_DRIVER_FLOAT_INVALID };
+    const size_t index = sample * block->channels;
+    for(uint8_t jj = 0; jj < block->channels; jj++)
+    {
+      if(sizeof(int16_t) == block->width)
+      {
+        int16_t raw = ((const int16_t*)block->values)[index + jj];
+        if(RUUVI_DRIVER_SENSOR_BLOCK_INVALID_S16 != raw) { values[jj] = raw * block->scale[jj]; }
+      }
+      else
+      {
+        int32_t raw = ((const int32_t*)block->values)[index + jj];
+        if(RUUVI_DRIVER_SENSOR_BLOCK_INVALID_S32 != raw) { values[jj] = raw * block->scale[jj]; }
+      }
+    }
+    data[ii].timestamp = timestamp;
+    data[ii].value0 = values[0];
+    data[ii].value1 = values[1];
+    data[ii].value2 = values[2];
+  }
+  *count = to_read;
+  return (to_read < available) ? RUUVI_DRIVER_STATUS_MORE_AVAILABLE : RUUVI_DRIVER_SUCCESS;
+}
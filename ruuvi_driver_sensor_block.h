@@ -0,0 +1,95 @@
+/**
+ * Compact block of sensor samples for history buffers.
+ *
+ * Block stores one 64-bit base timestamp, and either a 16-bit delta per sample or a fixed interval.
+ * Values are stored as int16_t or int32_t fixed point with a scale per channel.
+ * For example 3-axis acceleration in int16_t with deltas takes 8 bytes per sample
+ * instead of 24 bytes of ruuvi_driver_sensor_data_t, with fixed interval 6 bytes.
+ *
+ * Conversion functions take ruuvi_driver_sensor_data_t, which has the same layout as
+ * ruuvi_interface_acceleration_data_t, ruuvi_interface_environmental_data_t and ruuvi_interface_adc_data_t.
+ *
+ * License: BSD-3
+ * Author: Otso Jousimaa <otso@ojousima.net>
+ */
+#ifndef RUUVI_DRIVER_SENSOR_BLOCK_H
+#define RUUVI_DRIVER_SENSOR_BLOCK_H
+#include "ruuvi_driver_error.h"
+#include "ruuvi_driver_sensor.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define RUUVI_DRIVER_SENSOR_BLOCK_CHANNELS      3         // Maximum values per sample
+#define RUUVI_DRIVER_SENSOR_BLOCK_INVALID_S16   INT16_MIN // Stored value of RUUVI_DRIVER_FLOAT_INVALID in int16_t block
+#define RUUVI_DRIVER_SENSOR_BLOCK_INVALID_S32   INT32_MIN // Stored value of RUUVI_DRIVER_FLOAT_INVALID in int32_t block
+#define RUUVI_DRIVER_SENSOR_BLOCK_MAX_DELTA_MS  UINT16_MAX
+
+/**
+ * Bytes of value storage for given number of samples, channels and value width.
+ * Delta storage is capacity * sizeof(uint16_t) on top of this if fixed interval is not used.
+ */
+#define RUUVI_DRIVER_SENSOR_BLOCK_VALUE_BYTES(capacity, channels, width) ((capacity) * (channels) * (width))
+
+/**
+ * Block of samples. Storage and format are given by application, other fields are managed by block functions.
+ */
+typedef struct
+{
+  void*     values;       // capacity * channels values of width bytes, sample by sample
+  uint16_t* deltas;       // capacity deltas to previous sample in ms, NULL to use interval_ms
+  float     scale[RUUVI_DRIVER_SENSOR_BLOCK_CHANNELS]; // Unit per LSB of each channel
+  uint16_t  capacity;     // Number of samples storage holds
+  uint16_t  interval_ms;  // Fixed interval between samples, used if deltas is NULL
+  uint16_t  tolerance_ms; // Allowed deviation of sample from its slot in fixed interval, less than interval_ms / 2
+  uint8_t   channels;     // Values per sample, 1 ... RUUVI_DRIVER_SENSOR_BLOCK_CHANNELS
+  uint8_t   width;        // Bytes per value, sizeof(int16_t) or sizeof(int32_t)
+  uint16_t  count;        // Number of samples in block
+  uint64_t  base_ms;      // Timestamp of first sample
+  uint64_t  last_ms;      // Timestamp of latest sample
+}ruuvi_driver_sensor_block_t;
+
+/**
+ * Empty block and check its format.
+ *
+ * parameter block: block to reset
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if block or values is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_PARAM if channels, width, capacity or scale is invalid,
+ *         or if deltas is NULL and interval is 0 or not more than twice the tolerance
+ */
+ruuvi_driver_status_t ruuvi_driver_sensor_block_reset(ruuvi_driver_sensor_block_t* const block);
+
+/**
+ * Append samples to block. Values are rounded to nearest LSB and saturated to range of value type,
+ * RUUVI_DRIVER_FLOAT_INVALID is stored as RUUVI_DRIVER_SENSOR_BLOCK_INVALID_S16 or _S32.
+ * Samples must be in time order. If block uses fixed interval, timestamps after first sample are
+ * not stored and are reconstructed from interval, so sample n must be within tolerance_ms of
+ * base_ms + n * interval_ms.
+ *
+ * parameter block: block to append to
+ * parameter data: array of samples
+ * parameter count: Input: number of samples in data. Output: number of samples appended.
+ * return: RUUVI_DRIVER_SUCCESS if all samples were appended
+ * return: RUUVI_DRIVER_ERROR_NO_MEM if block became full
+ * return: RUUVI_DRIVER_ERROR_INVALID_DATA if a timestamp is invalid, goes backwards, delta does not fit in 16 bits
+ *         or sample is off its slot in fixed interval, for example after a missed sample.
+ *         Start a new block from that sample.
+ * return: RUUVI_DRIVER_ERROR_NULL if any parameter is NULL
+ */
+ruuvi_driver_status_t ruuvi_driver_sensor_block_append(ruuvi_driver_sensor_block_t* const block, const ruuvi_driver_sensor_data_t* const data, size_t* const count);
+
+/**
+ * Expand samples of block back to ruuvi_driver_sensor_data_t.
+ * Channels which are not stored in block are RUUVI_DRIVER_FLOAT_INVALID.
+ *
+ * parameter block: block to read
+ * parameter start: index of first sample to read
+ * parameter data: array of room for *count samples
+ * parameter count: Input: number of samples data has room for. Output: number of samples placed in data.
+ * return: RUUVI_DRIVER_SUCCESS if samples up to end of block were read
+ * return: RUUVI_DRIVER_STATUS_MORE_AVAILABLE if block has more samples after the ones read
+ * return: RUUVI_DRIVER_ERROR_NULL if any parameter is NULL
+ */
+ruuvi_driver_status_t ruuvi_driver_sensor_block_read(const ruuvi_driver_sensor_block_t* const block, const size_t start, ruuvi_driver_sensor_data_t* const data, size_t* const count);
+
+#endif
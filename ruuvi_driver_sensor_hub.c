@@ -0,0 +1,135 @@
+#include "ruuvi_driver_error.h"
+#include "ruuvi_driver_sensor.h"
+#include "ruuvi_driver_sensor_hub.h"
+#include "ruuvi_driver_sensor_ring.h"
+#include "ruuvi_interface_scheduler.h"
+#include "ruuvi_interface_timer.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Longest single timer period, longer sleeps are split.
+// Half of the 24-bit RTC range of application timers at 32768 Hz, 512 s.
+#define HUB_MAX_SLEEP_MS (256UL * 1000UL)
+// Delay before trying again if scheduler queue is full.
+#define HUB_RETRY_MS 10U
+
+RUUVI_PLATFORM_TIMER_ID_DEF(hub_timer);
+static bool hub_timer_created = false;
+static bool hub_running = false;
+static ruuvi_driver_sensor_hub_entry_t* p_entries = NULL;
+static size_t entry_count = 0;
+static uint32_t hub_wakeups = 0;
+static uint32_t hub_samples = 0;
+static uint32_t hub_failures = 0;
+
+// Take one sample of sensor in entry and push it into ring of entry.
+static ruuvi_driver_status_t hub_sample(const ruuvi_driver_sensor_hub_entry_t* const entry)
+{
+  uint8_t mode = RUUVI_DRIVER_SENSOR_CFG_SLEEP;
+  ruuvi_driver_status_t err_code = entry->sensor->mode_get(&mode);
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+  // Continuous sensors have a fresh sample already, others are triggered.
+  if(RUUVI_DRIVER_SENSOR_CFG_CONTINUOUS != mode)
+  {
+    mode = RUUVI_DRIVER_SENSOR_CFG_SINGLE;
+    err_code = entry->sensor->mode_set(&mode);
+    if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+  }
+  return ruuvi_driver_sensor_ring_sample(entry->ring, entry->sensor);
+}
+
+// Sample every sensor whose window is open and arm timer for the earliest deadline. Runs in scheduler context.
+static void hub_sample_task(void* p_event_data, uint16_t event_size)
+{
+  if(!hub_running) { return; }
+  uint64_t now = ruuvi_driver_sensor_timestamp_get();
+  uint64_t wakeup = UINT64_MAX;
+  for(size_t ii = 0; ii < entry_count; ii++)
+  {
+    ruuvi_driver_sensor_hub_entry_t* const entry = &(p_entries[ii]);
+    if(entry->next_ms <= now + entry->tolerance_ms)
+    {
+      if(RUUVI_DRIVER_SUCCESS == hub_sample(entry)) { hub_samples++; }
+      else { hub_failures++; }
+      // Keep sensors on the common timeline, skip instants which were missed.
+      entry->next_ms += entry->interval_ms;
+      while(entry->next_ms <= now) { entry->next_ms += entry->interval_ms; }
+    }
+    if(entry->next_ms < wakeup) { wakeup = entry->next_ms; }
+  }
+  hub_wakeups++;
+
+  // Sampling takes time, check the clock again before sleeping.
+  now = ruuvi_driver_sensor_timestamp_get();
+  uint64_t sleep_ms = (wakeup > now) ? (wakeup - now) : 1;
+  if(HUB_MAX_SLEEP_MS < sleep_ms) { sleep_ms = HUB_MAX_SLEEP_MS; }
+  ruuvi_platform_timer_start(hub_timer, (uint32_t)sleep_ms);
+}
+
+// Sensors may block and need the bus, defer sampling to scheduler.
+static void hub_timeout_handler(void* p_context)
+{
+  if(!hub_running) { return; }
+  // Sampling would stop for good if the event was lost, retry shortly.
+  if(RUUVI_DRIVER_SUCCESS != ruuvi_platform_scheduler_event_put(NULL, 0, hub_sample_task))
+  {
+    hub_failures++;
+    ruuvi_platform_timer_start(hub_timer, HUB_RETRY_MS);
+  }
+}
+
+ruuvi_driver_status_t ruuvi_driver_sensor_hub_start(ruuvi_driver_sensor_hub_entry_t* const entries, const size_t count)
+{
+  if(NULL == entries) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(hub_running) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  for(size_t ii = 0; ii < count; ii++)
+  {
+    if(NULL == entries[ii].sensor || NULL == entries[ii].ring) { return RUUVI_DRIVER_ERROR_NULL; }
+    if(NULL == entries[ii].sensor->mode_set
+       || NULL == entries[ii].sensor->mode_get
+       || NULL == entries[ii].sensor->data_get)
+    {
+      return RUUVI_DRIVER_ERROR_INVALID_STATE;
+    }
+    if(0 == entries[ii].interval_ms || entries[ii].tolerance_ms >= entries[ii].interval_ms) { return RUUVI_DRIVER_ERROR_INVALID_PARAM; }
+  }
+  uint64_t now = ruuvi_driver_sensor_timestamp_get();
+  if(RUUVI_DRIVER_UINT64_INVALID == now) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+
+  ruuvi_driver_status_t err_code = RUUVI_DRIVER_SUCCESS;
+  if(!hub_timer_created)
+  {
+    err_code |= ruuvi_platform_timer_create(&hub_timer, RUUVI_INTERFACE_TIMER_MODE_SINGLE_SHOT, hub_timeout_handler);
+    if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+    hub_timer_created = true;
+  }
+
+  // Common timeline starts now, every sensor is due on first wakeup.
+  for(size_t ii = 0; ii < count; ii++)
+  {
+    entries[ii].next_ms = now;
+  }
+  p_entries = entries;
+  entry_count = count;
+  hub_wakeups = 0;
+  hub_samples = 0;
+  hub_failures = 0;
+  hub_running = true;
+  err_code |= ruuvi_platform_timer_start(hub_timer, 1);
+  if(RUUVI_DRIVER_SUCCESS != err_code) { hub_running = false; }
+  return err_code;
+}
+
+ruuvi_driver_status_t ruuvi_driver_sensor_hub_stop(void)
+{
+  if(!hub_running) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  hub_running = false;
+  return ruuvi_platform_timer_stop(hub_timer);
+}
+
+void ruuvi_driver_sensor_hub_stats_get(uint32_t* const wakeups, uint32_t* const samples, uint32_t* const failures)
+{
+  if(NULL != wakeups) { *wakeups = hub_wakeups; }
+  if(NULL != samples) { *samples = hub_samples; }
+  if(NULL != failures) { *failures = hub_failures; }
+}
@@ -0,0 +1,70 @@
+/**
+ * Sensor hub samples several sensors from one timer.
+ *
+ * Each sensor has its own interval and a tolerance for how much earlier than due its sample may be taken.
+ * Sample instants of all sensors are aligned on a common timeline starting from hub start,
+ * so sensors with harmonic intervals fall on the same instants. On every wakeup the hub reads
+ * every sensor whose tolerance window is open, and sleeps until the earliest next deadline.
+ *
+ * Timer only schedules the sampling, sensors are read in scheduler context where they may block and use the bus.
+ * Timers and scheduler must be initialized, sensors must be initialized and timestamp function must be set
+ * with ruuvi_driver_sensor_timestamp_function_set.
+ *
+ * License: BSD-3
+ * Author: Otso Jousimaa <otso@ojousima.net>
+ */
+#ifndef RUUVI_DRIVER_SENSOR_HUB_H
+#define RUUVI_DRIVER_SENSOR_HUB_H
+#include "ruuvi_driver_error.h"
+#include "ruuvi_driver_sensor.h"
+#include "ruuvi_driver_sensor_ring.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * One sensor sampled by hub. Storage is given by application, next_ms is managed by hub.
+ */
+typedef struct
+{
+  const ruuvi_driver_sensor_t* sensor; // Initialized sensor
+  ruuvi_driver_sensor_ring_t* ring;    // Samples are pushed here
+  uint32_t interval_ms;                // Nominal interval between samples, > 0
+  uint32_t tolerance_ms;               // Sample may be taken up to this much before it is due, < interval_ms
+  uint64_t next_ms;                    // Time when next sample is due
+}ruuvi_driver_sensor_hub_entry_t;
+
+/**
+ * Start sampling given sensors. First samples are taken on the first wakeup.
+ *
+ * parameter entries: array of sensors to sample. Must stay valid until hub is stopped.
+ * parameter count: number of entries
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if entries, sensor or ring of any entry is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_PARAM if interval of any entry is 0 or tolerance is not less than interval
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if hub is running, timestamps are not available or
+ *         mode_set, mode_get or data_get of any sensor is NULL
+ * return: error code from timer on error.
+ */
+ruuvi_driver_status_t ruuvi_driver_sensor_hub_start(ruuvi_driver_sensor_hub_entry_t* const entries, const size_t count);
+
+/**
+ * Stop sampling. Sensors are left in their current mode.
+ *
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if hub is not running
+ */
+ruuvi_driver_status_t ruuvi_driver_sensor_hub_stop(void);
+
+/**
+ * Number of wakeups, samples taken and samples lost since hub was started.
+ * Samples per wakeup tells how well sampling is coalesced. Sample is lost if sensor returns an error,
+ * has no valid data or ring is full.
+ *
+ * parameter wakeups: Output, number of wakeups. May be NULL.
+ * parameter samples: Output, number of sensor samples pushed into rings. May be NULL.
+ * parameter failures: Output, number of due samples which could not be taken or stored
+ *                     and wakeups which could not be scheduled. May be NULL.
+ */
+void ruuvi_driver_sensor_hub_stats_get(uint32_t* const wakeups, uint32_t* const samples, uint32_t* const failures);
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * Single-producer, single-consumer ring buffer of sensor samples.
+ *
+ * Producer may run in interrupt context, for example on data ready or FIFO watermark interrupt,
+ * and consumer in application context. Neither side blocks or disables interrupts:
+ * producer is the only writer of head and consumer the only writer of tail.
+ * Samples which do not fit are dropped and counted as overflows.
+ *
+ * All sensor data formats share the layout of ruuvi_driver_sensor_data_t, i.e.
+ * ruuvi_interface_acceleration_data_t, ruuvi_interface_environmental_data_t and
+ * ruuvi_interface_adc_data_t can be pushed as they are.
+ *
+ * License: BSD-3
+ * Author: Otso Jousimaa <otso@ojousima.net>
+ */
+#ifndef RUUVI_DRIVER_SENSOR_RING_H
+#define RUUVI_DRIVER_SENSOR_RING_H
+#include "ruuvi_driver_error.h"
+#include "ruuvi_driver_sensor.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Ring buffer state. Storage is given by application.
+ */
+typedef struct
+{
+  ruuvi_driver_sensor_data_t* samples; // Storage of capacity samples
+  uint32_t capacity;                   // Number of samples, must be a power of two
+  uint32_t head;                       // Free-running write counter, written by producer only
+  uint32_t tail;                       // Free-running read counter, written by consumer only
+  uint32_t overflows;                  // Number of samples dropped because ring was full, written by producer only
+}ruuvi_driver_sensor_ring_t;
+
+/**
+ * Setup ring buffer on given storage. Must not be called while producer or consumer uses the ring.
+ *
+ * parameter ring: ring to setup
+ * parameter samples: storage of capacity samples
+ * parameter capacity: number of samples, must be a power of two
+ * return: RUUVI_DRIVER_SUCCESS on success
+ * return: RUUVI_DRIVER_ERROR_NULL if ring or samples is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_LENGTH if capacity is not a power of two
+ */
+static inline ruuvi_driver_status_t ruuvi_driver_sensor_ring_init(ruuvi_driver_sensor_ring_t* const ring, ruuvi_driver_sensor_data_t* const samples, const uint32_t capacity)
+{
+  if(NULL == ring || NULL == samples) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(0 == capacity || (capacity & (capacity - 1))) { return RUUVI_DRIVER_ERROR_INVALID_LENGTH; }
+  ring->samples = samples;
+  ring->capacity = capacity;
+  ring->head = 0;
+  ring->tail = 0;
+  ring->overflows = 0;
+  return RUUVI_DRIVER_SUCCESS;
+}
+
+/**
+ * Push a block of samples into ring. Producer side.
+ * Samples are published to consumer at once after they have been copied.
+ *
+ * parameter ring: ring to push into
+ * parameter data: array of count samples in ruuvi_driver_sensor_data_t layout
+ * parameter count: number of samples to push
+ * return: RUUVI_DRIVER_SUCCESS if all samples were pushed
+ * return: RUUVI_DRIVER_ERROR_NO_MEM if some samples were dropped, dropped samples are counted as overflows
+ * return: RUUVI_DRIVER_ERROR_NULL if ring or data is NULL
+ */
+static inline ruuvi_driver_status_t ruuvi_driver_sensor_ring_push(ruuvi_driver_sensor_ring_t* const ring, const ruuvi_driver_sensor_data_t* const data, const size_t count)
+{
+  if(NULL == ring || NULL == data) { return RUUVI_DRIVER_ERROR_NULL; }
+  const uint32_t head = ring->head;
+  const uint32_t tail = __atomic_load_n(&(ring->tail), __ATOMIC_ACQUIRE);
+  const uint32_t space = ring->capacity - (head - tail);
+  const uint32_t to_copy = (count < space) ? count : space;
+  for(uint32_t ii = 0; ii < to_copy; ii++)
+  {
+    ring->samples[(head + ii) & (ring->capacity - 1)] = data[ii];
+  }
+  __atomic_store_n(&(ring->head), head + to_copy, __ATOMIC_RELEASE);
+  if(to_copy == count) { return RUUVI_DRIVER_SUCCESS; }
+  __atomic_store_n(&(ring->overflows), ring->overflows + (count - to_copy), __ATOMIC_RELAXED);
+  return RUUVI_DRIVER_ERROR_NO_MEM;
+}
+
+/**
+ * Pop oldest samples from ring. Consumer side.
+ *
+ * parameter ring: ring to pop from
+ * parameter data: array of room for *count samples
+ * parameter count: Input: number of samples data has room for. Output: number of samples placed in data
+ * return: RUUVI_DRIVER_SUCCESS if ring was emptied
+ * return: RUUVI_DRIVER_STATUS_MORE_AVAILABLE if there are samples left in ring
+ * return: RUUVI_DRIVER_ERROR_NULL if any parameter is NULL
+ */
+static inline ruuvi_driver_status_t ruuvi_driver_sensor_ring_pop(ruuvi_driver_sensor_ring_t* const ring, ruuvi_driver_sensor_data_t* const data, size_t* const count)
+{
+  if(NULL == ring || NULL == data || NULL == count) { return RUUVI_DRIVER_ERROR_NULL; }
+  const uint32_t tail = ring->tail;
+  const uint32_t head = __atomic_load_n(&(ring->head), __ATOMIC_ACQUIRE);
+  const uint32_t available = head - tail;
+  const uint32_t to_copy = (*count < available) ? *count : available;
+  for(uint32_t ii = 0; ii < to_copy; ii++)
+  {
+    data[ii] = ring->samples[(tail + ii) & (ring->capacity - 1)];
+  }
+  __atomic_store_n(&(ring->tail), tail + to_copy, __ATOMIC_RELEASE);
+  *count = to_copy;
+  return (to_copy < available) ? RUUVI_DRIVER_STATUS_MORE_AVAILABLE : RUUVI_DRIVER_SUCCESS;
+}
+
+/**
+ * Number of samples waiting in ring. Exact on consumer side, a lower bound elsewhere.
+ */
+static inline uint32_t ruuvi_driver_sensor_ring_count(const ruuvi_driver_sensor_ring_t* const ring)
+{
+  return __atomic_load_n(&(ring->head), __ATOMIC_ACQUIRE) - __atomic_load_n(&(ring->tail), __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Number of samples dropped because ring was full since ring_init.
+ */
+static inline uint32_t ruuvi_driver_sensor_ring_overflows(const ruuvi_driver_sensor_ring_t* const ring)
+{
+  return __atomic_load_n(&(ring->overflows), __ATOMIC_RELAXED);
+}
+
+/**
+ * Read latest sample of sensor with data_get and push it into ring.
+ * Lets any sensor driver publish into ring, for example from data ready interrupt or timer.
+ * Samples with invalid timestamp are not pushed.
+ *
+ * parameter ring: ring to push into
+ * parameter sensor: initialized sensor
+ * return: RUUVI_DRIVER_SUCCESS if sample was pushed
+ * return: RUUVI_DRIVER_STATUS_NO_NEW_DATA if sensor had no valid sample
+ * return: RUUVI_DRIVER_ERROR_NO_MEM if ring was full and sample was dropped
+ * return: RUUVI_DRIVER_ERROR_NULL if ring or sensor is NULL
+ * return: RUUVI_DRIVER_ERROR_INVALID_STATE if sensor is not initialized
+ * return: error code from sensor on error
+ */
+static inline ruuvi_driver_status_t ruuvi_driver_sensor_ring_sample(ruuvi_driver_sensor_ring_t* const ring, const ruuvi_driver_sensor_t* const sensor)
+{
+  if(NULL == ring || NULL == sensor) { return RUUVI_DRIVER_ERROR_NULL; }
+  if(NULL == sensor->data_get) { return RUUVI_DRIVER_ERROR_INVALID_STATE; }
+  ruuvi_driver_sensor_data_t sample;
+  ruuvi_driver_status_t err_code = sensor->data_get(&sample);
+  if(RUUVI_DRIVER_SUCCESS != err_code) { return err_code; }
+  if(RUUVI_DRIVER_UINT64_INVALID == sample.timestamp) { return RUUVI_DRIVER_STATUS_NO_NEW_DATA; }
+  return ruuvi_driver_sensor_ring_push(ring, &sample, 1);
+}
+
+#endif